@@ -0,0 +1,91 @@
+# Macro-benchmark: times parsing, annotation, CFG construction, and each
+# stage of ControlFlowGraph#analyze over the bundled standard library.
+#
+#   ruby bench/analysis_bench.rb [file ...]
+#
+# Stage times are exclusive: methods analyzed lazily during simulation are
+# charged to their own stages, not to the simulation. Each file is analyzed
+# once, as analyzing it again would see its own definitions.
+#
+# Environment: BENCH_OUTPUT (JSON path).
+require File.expand_path('../bench_helper', __FILE__)
+require 'laser'
+
+module Laser
+  module Bench
+    module AnalysisBench
+      CORPUS = Dir[File.join(Laser::ROOT, 'laser', 'standard_library', '**', '*.rb')].sort
+      # The stages of ControlFlowGraph#analyze, in the order it runs them.
+      STAGES = [:perform_dead_code_discovery, :static_single_assignment_form, :simulate,
+                :perform_constant_propagation, :kill_unexecuted_edges,
+                :prune_totally_useless_blocks, :add_unused_variable_warnings,
+                :find_yield_properties, :find_raise_properties]
+
+      @frames = []
+      @totals = Hash.new(0.0)
+
+      def self.run(report, files = CORPUS)
+        instrument
+        overall = Hash.new(0.0)
+        files.each do |path|
+          @totals.clear
+          error = nil
+          begin
+            analyze_file(path)
+          rescue StandardError => err
+            error = "#{err.class}: #{err.message}"
+          end
+          result = {name: 'analyze_file', file: relative_path(path),
+                    total: @totals.values.inject(0.0, :+), stages: @totals.dup}
+          result[:error] = error if error
+          report.record(result)
+          @totals.each { |stage, time| overall[stage] += time }
+        end
+        report.record(name: 'analyze_corpus', files: files.size,
+                      total: overall.values.inject(0.0, :+), stages: overall)
+        report
+      end
+
+      def self.analyze_file(path)
+        text = File.read(path)
+        tree = time_stage(:parse) { Analysis::Sexp.new(RipperPlus.sexp(text), path, text) }
+        time_stage(:annotate) { Analysis::Annotations.apply_inherited_attributes([[path, text, tree]]) }
+        graph = time_stage(:build) { Analysis::ControlFlow::GraphBuilder.new(tree).build }
+        graph.analyze
+      end
+
+      # Wraps each stage method of ControlFlowGraph to charge its time.
+      def self.instrument
+        klass = Analysis::ControlFlow::ControlFlowGraph
+        STAGES.each do |stage|
+          original = klass.instance_method(stage)
+          visibility = klass.private_method_defined?(stage) ? :private : :public
+          klass.send(:define_method, stage) do |*args, &blk|
+            AnalysisBench.time_stage(stage) { original.bind(self).call(*args, &blk) }
+          end
+          klass.send(visibility, stage)
+        end
+      end
+
+      def self.time_stage(stage)
+        frame = [Bench.clock, 0.0]
+        @frames.push(frame)
+        yield
+      ensure
+        @frames.pop
+        elapsed = Bench.clock - frame[0]
+        @frames.last[1] += elapsed if @frames.any?
+        @totals[stage] += elapsed - frame[1]
+      end
+
+      def self.relative_path(path)
+        path.sub(File.join(Laser::ROOT, ''), '')
+      end
+    end
+  end
+end
+
+if __FILE__ == $0
+  files = ARGV.empty? ? Laser::Bench::AnalysisBench::CORPUS : ARGV.map { |file| File.expand_path(file) }
+  Laser::Bench::AnalysisBench.run(Laser::Bench::Report.new('analysis'), files).write
+end
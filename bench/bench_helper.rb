@@ -0,0 +1,79 @@
+$:.unshift(File.expand_path('../../lib', __FILE__))
+$:.unshift(File.expand_path('../../ext', __FILE__))
+require 'json'
+require 'rbconfig'
+require 'laser/version'
+
+module Laser
+  module Bench
+    # How many times each measurement is repeated; the best and median
+    # runs are reported.
+    REPEAT = (ENV['BENCH_REPEAT'] || 5).to_i
+    # Multiplies the size of every synthetic graph.
+    SCALE = (ENV['BENCH_SCALE'] || 1).to_f
+
+    def self.clock
+      Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    end
+
+    def self.scaled(size)
+      [(size * SCALE).round, 1].max
+    end
+
+    # Collects the measurements of one suite and writes them as a single
+    # JSON document, so results can be compared between releases. A
+    # readable summary goes to stderr as it runs.
+    class Report
+      attr_reader :results
+
+      def initialize(suite)
+        @suite = suite
+        @results = []
+      end
+
+      # Times the block REPEAT times. The setup, if given, runs before each
+      # repetition, outside the timing, and its result is yielded.
+      def measure(name, attrs={}, setup=nil)
+        times = (1..REPEAT).map do
+          state = setup && setup.call
+          start = Bench.clock
+          yield state
+          Bench.clock - start
+        end.sort
+        record({name: name}.merge(attrs).merge(repeat: REPEAT, best: times.first,
+                                               median: times[times.size / 2]))
+      end
+
+      def record(result)
+        @results << result
+        $stderr.puts(result.map { |key, value| "#{key}=#{format_value(value)}" }.join(' '))
+        result
+      end
+
+      def to_json(*args)
+        {suite: @suite,
+         laser: Laser::Version::STRING,
+         ruby: RUBY_DESCRIPTION,
+         platform: RbConfig::CONFIG['host'],
+         time: Time.now.utc.strftime('%Y-%m-%dT%H:%M:%SZ'),
+         scale: SCALE,
+         results: @results}.to_json(*args)
+      end
+
+      # Writes to the path in BENCH_OUTPUT, or stdout if it isn't set.
+      def write(path = ENV['BENCH_OUTPUT'])
+        if path
+          File.open(path, 'w') { |file| file.puts(JSON.pretty_generate(JSON.parse(to_json))) }
+        else
+          puts to_json
+        end
+      end
+
+     private
+
+      def format_value(value)
+        Float === value ? '%.6f' % value : value
+      end
+    end
+  end
+end
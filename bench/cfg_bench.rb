@@ -0,0 +1,76 @@
+# Micro-benchmarks of the native CFG layer: edge storage, flag queries,
+# filtered views, and the traversal primitives, over synthetic graphs.
+#
+#   ruby bench/cfg_bench.rb [shape ...]
+#
+# Environment: BENCH_OUTPUT (JSON path), BENCH_REPEAT, BENCH_SCALE.
+require File.expand_path('../bench_helper', __FILE__)
+require File.expand_path('../cfg_shapes', __FILE__)
+
+module Laser
+  module Bench
+    module CFGBench
+      SIZES = {straight_line: 5000, nested_loops: 500, wide_case: 2000, exception_heavy: 2000}
+      EXECUTABLE = RGL::ControlFlowGraph::EDGE_EXECUTABLE
+
+      def self.run(report, shapes = CFGShapes::ALL)
+        shapes.each do |shape_name|
+          size = Bench.scaled(SIZES[shape_name])
+          fresh = lambda { CFGShapes.send(shape_name, size) }
+          sample = fresh.call
+          attrs = {shape: shape_name, size: size, vertices: sample.graph.num_vertices,
+                   edges: sample.graph.num_edges}
+
+          report.measure('build', attrs) { fresh.call }
+          report.measure('flag_queries', attrs.merge(ops: 2 * sample.pairs.size), fresh) do |shape|
+            shape.pairs.each do |from, to|
+              from.get_flags(to)
+              from.has_flag?(to, EXECUTABLE)
+            end
+          end
+          report.measure('filtered_views', attrs.merge(ops: 2 * sample.blocks.size), fresh) do |shape|
+            shape.blocks.each do |block|
+              block.real_successors
+              block.real_predecessors
+            end
+          end
+          report.measure('filtered_each', attrs.merge(ops: 2 * sample.blocks.size), fresh) do |shape|
+            shape.blocks.each do |block|
+              block.each_normal_successors { }
+              block.any_executed_predecessor?
+            end
+          end
+          report.measure('disconnect_join', attrs.merge(ops: 2 * sample.pairs.size), fresh) do |shape|
+            shape.pairs.each { |from, to| from.disconnect_without_fixup(to) }
+            shape.pairs.each { |from, to| from.join(to) }
+          end
+          report.measure('insert_block_on_edge', attrs.merge(ops: sample.pairs.size), fresh) do |shape|
+            shape.pairs.each_with_index do |(from, to), i|
+              inserted = CFGShapes::BasicBlock.new("Inserted#{i}")
+              shape.graph.add_vertex(inserted)
+              from.insert_block_on_edge(to, inserted)
+            end
+          end
+          report.measure('reverse_post_order', attrs, fresh) { |shape| shape.graph.reverse_post_order }
+          report.measure('dominator_tree', attrs, fresh) { |shape| shape.graph.dominator_tree }
+          report.measure('dominance_frontier', attrs, fresh) do |shape|
+            shape.graph.dominator_tree
+            shape.graph.dominance_frontier
+          end
+          report.measure('copy_topology', attrs, fresh) do |shape|
+            RGL::ControlFlowGraph.new.copy_topology(shape.graph)
+          end
+          report.measure('precompute_all', attrs.merge(graphs: 8), lambda { (1..8).map { fresh.call.graph } }) do |graphs|
+            Analysis::ControlFlow.precompute_all(graphs)
+          end
+        end
+        report
+      end
+    end
+  end
+end
+
+if __FILE__ == $0
+  shapes = ARGV.empty? ? Laser::Bench::CFGShapes::ALL : ARGV.map(&:to_sym)
+  Laser::Bench::CFGBench.run(Laser::Bench::Report.new('cfg'), shapes).write
+end
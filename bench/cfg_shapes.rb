@@ -0,0 +1,95 @@
+require 'set'
+require 'laser/BasicBlock'
+require 'laser/third_party/rgl/control_flow'
+require 'laser/analysis/control_flow/basic_block'
+require 'laser/third_party/rgl/dominators'
+
+module Laser
+  module Bench
+    # Synthetic control flow graphs shaped like the extremes real methods
+    # reach. Each generator returns a Shape holding the graph, its blocks
+    # other than Enter and Exit, and the [from, to] pairs of its edges.
+    module CFGShapes
+      Shape = Struct.new(:name, :size, :graph, :blocks, :pairs)
+      BasicBlock = Analysis::ControlFlow::BasicBlock
+      NORMAL = RGL::ControlFlowGraph::EDGE_NORMAL
+      ABNORMAL = RGL::ControlFlowGraph::EDGE_ABNORMAL
+
+      ALL = [:straight_line, :nested_loops, :wide_case, :exception_heavy]
+
+      # Enter -> B0 -> B1 -> ... -> Exit
+      def self.straight_line(size)
+        build(:straight_line, size) do |graph, blocks, edges|
+          line = add_blocks(graph, blocks, 'B', size)
+          edges << [graph.enter, line.first, NORMAL]
+          line.each_cons(2) { |from, to| edges << [from, to, NORMAL] }
+          edges << [line.last, graph.exit, NORMAL]
+        end
+      end
+
+      # Loops nested size deep: each header enters the next loop or exits to
+      # its latch, and each latch jumps back to its header.
+      def self.nested_loops(size)
+        build(:nested_loops, size) do |graph, blocks, edges|
+          headers = add_blocks(graph, blocks, 'Header', size)
+          latches = add_blocks(graph, blocks, 'Latch', size)
+          body = add_blocks(graph, blocks, 'Body', 1).first
+          edges << [graph.enter, headers.first, NORMAL]
+          headers.each_cons(2) { |outer, inner| edges << [outer, inner, NORMAL] }
+          edges << [headers.last, body, NORMAL]
+          edges << [body, latches.last, NORMAL]
+          size.times do |i|
+            edges << [latches[i], headers[i], NORMAL]
+            edges << [headers[i], i.zero? ? graph.exit : latches[i - 1], NORMAL]
+          end
+        end
+      end
+
+      # A case statement with size arms, all joining afterwards.
+      def self.wide_case(size)
+        build(:wide_case, size) do |graph, blocks, edges|
+          switch, join = add_blocks(graph, blocks, 'Case', 2)
+          edges << [graph.enter, switch, NORMAL]
+          add_blocks(graph, blocks, 'Arm', size).each do |arm|
+            edges << [switch, arm, NORMAL]
+            edges << [arm, join, NORMAL]
+          end
+          edges << [switch, join, NORMAL]
+          edges << [join, graph.exit, NORMAL]
+        end
+      end
+
+      # A line of size calls that may each raise into one rescue block,
+      # which then has an abnormal in-degree of size.
+      def self.exception_heavy(size)
+        build(:exception_heavy, size) do |graph, blocks, edges|
+          calls = add_blocks(graph, blocks, 'Call', size)
+          rescue_block = add_blocks(graph, blocks, 'Rescue', 1).first
+          edges << [graph.enter, calls.first, NORMAL]
+          calls.each_cons(2) { |from, to| edges << [from, to, NORMAL] }
+          calls.each { |call| edges << [call, rescue_block, ABNORMAL] }
+          edges << [calls.last, graph.exit, NORMAL]
+          edges << [rescue_block, graph.exit, NORMAL]
+        end
+      end
+
+      def self.build(name, size)
+        graph = RGL::ControlFlowGraph.new
+        blocks = []
+        edges = []
+        yield graph, blocks, edges
+        graph.add_edges(edges.flatten(1))
+        Shape.new(name, size, graph, blocks, edges.map { |from, to, _| [from, to] })
+      end
+
+      def self.add_blocks(graph, blocks, prefix, count)
+        (0...count).map do |i|
+          block = BasicBlock.new("#{prefix}#{i}")
+          graph.add_vertex(block)
+          blocks << block
+          block
+        end
+      end
+    end
+  end
+end
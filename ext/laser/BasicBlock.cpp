@@ -1,4 +1,13 @@
 #include "BasicBlock.h"
+#include "Dominators.h"
+#include "Liveness.h"
+#include "ConstantPropagation.h"
+#include "StaticSingleAssignment.h"
+#include "Precompute.h"
+#include "Overlay.h"
+#include "Loops.h"
+#include "Sets.h"
+#include "ControlFlowGraph.h"
 #include "ruby.h"
 
 VALUE rb_mLaser;
@@ -8,84 +17,308 @@ VALUE rb_cBasicBlock;
 
 using namespace Laser;
 
+NativeCounters Laser::native_counters;
+
+const EdgeFilter Laser::edge_filters[NUM_EDGE_FILTERS] = {
+	{ 0, 0 },                                        // FILTER_ALL
+	{ EDGE_FAKE, 0 },                                // FILTER_REAL
+	{ EDGE_ABNORMAL, 0 },                            // FILTER_NORMAL
+	{ EDGE_ABNORMAL, EDGE_ABNORMAL },                // FILTER_ABNORMAL
+	{ EDGE_BLOCK_TAKEN, EDGE_BLOCK_TAKEN },          // FILTER_BLOCK_TAKEN
+	{ EDGE_ABNORMAL | EDGE_BLOCK_TAKEN, EDGE_ABNORMAL }, // FILTER_EXCEPTION
+	{ EDGE_EXECUTABLE, EDGE_EXECUTABLE },            // FILTER_EXECUTED
+	{ EDGE_EXECUTABLE, 0 },                          // FILTER_UNEXECUTED
+};
+
+// The edge pool: slabs of EDGE_SLAB_SIZE edges, never moved once allocated,
+// with freed edges threaded through in_pos into a free list.
+static const uint32_t EDGE_SLAB_BITS = 10;
+static const uint32_t EDGE_SLAB_SIZE = 1 << EDGE_SLAB_BITS;
+static const uint32_t NO_EDGE = ~(uint32_t)0;
+static const size_t EDGE_INDEX_THRESHOLD = 16;
+static std::vector<BasicBlock::Edge*> edge_slabs;
+static uint32_t edge_free_list = NO_EDGE;
+static uint32_t edge_high_water = 0;
+
+BasicBlock::Edge* BasicBlock::edge_at(uint32_t index) {
+	return &edge_slabs[index >> EDGE_SLAB_BITS][index & (EDGE_SLAB_SIZE - 1)];
+}
+
+BasicBlock::Edge* BasicBlock::allocate_edge(BasicBlock* from, BasicBlock* to, uint8_t flags) {
+	Edge* edge;
+	if (edge_free_list != NO_EDGE) {
+		edge = edge_at(edge_free_list);
+		edge_free_list = edge->in_pos;
+	} else {
+		if ((edge_high_water >> EDGE_SLAB_BITS) == edge_slabs.size()) {
+			edge_slabs.push_back(new Edge[EDGE_SLAB_SIZE]);
+		}
+		edge = edge_at(edge_high_water);
+		edge->index = edge_high_water++;
+	}
+	edge->from = from;
+	edge->to = to;
+	edge->flags = flags;
+	++native_counters.edges_created;
+	return edge;
+}
+
+void BasicBlock::free_edge(Edge* edge) {
+	if (edge->from->_graph) {
+		edge->from->_graph->edge_removed(edge);
+	}
+	edge->from = edge->to = NULL;
+	edge->in_pos = edge_free_list;
+	edge_free_list = edge->index;
+	++native_counters.edges_destroyed;
+}
+
+void BasicBlock::remove_edge(Edge* edge) {
+	BasicBlock* from = edge->from;
+	BasicBlock* to = edge->to;
+	uint8_t flags = edge->flags;
+	from->remove_outgoing(edge);
+	to->remove_incoming(edge);
+	from->clear_edge_cache();
+	to->clear_edge_cache();
+	free_edge(edge);
+	IncrementalDominators::edge_removed(from, to, flags);
+}
+
 BasicBlock::BasicBlock(BasicBlock& other) {
 	_name = other.name();
-	_instructions = other.instructions();
-	_incoming = other.predecessors();
-	_outgoing = other.successors();
-	_cache_flags = 0;
+	_instructions = rb_ary_dup(other.instructions());
+	_phi_count = other.phi_count();
+	_generation = 1;
+	for (int slot = 0; slot < 2 * NUM_EDGE_FILTERS; ++slot) {
+		_view_generations[slot] = 0;
+	}
+	_idom = NULL;
+	_dom_root = NULL;
+	_dom_generation = 0;
+	_dom_numbered = false;
+	_frontier_generation = 0;
+	_edge_index = NULL;
+	_parallel_edges = 0;
+	_graph = NULL;
+	_id = NO_ID;
+	_preorder = NO_ID;
+	_post_order = NO_ID;
+	_dfs_parent = NULL;
 }
 
-void BasicBlock::join(BasicBlock *other) {
-	clear_cache();
-	other->clear_cache();
-	Edge *new_edge = new Edge(this, other);
-	_outgoing.push_back(new_edge);
-	other->_incoming.push_back(new_edge);
+static ID id_body;
+static VALUE sym_phi;
+
+// Instructions keep their body Array in @body; bare Arrays are their own.
+static bool is_phi(VALUE instruction) {
+	VALUE body = RB_TYPE_P(instruction, T_ARRAY) ? instruction : rb_ivar_get(instruction, id_body);
+	return RB_TYPE_P(body, T_ARRAY) && rb_ary_entry(body, 0) == sym_phi;
 }
 
-// Disconnects the block as the source in an edge
-void BasicBlock::disconnect(BasicBlock *other) {
-	using namespace std;
+void BasicBlock::set_instructions(VALUE instructions) {
+	_instructions = instructions;
+	_phi_count = 0;
+	while (_phi_count < RARRAY_LEN(instructions) && is_phi(rb_ary_entry(instructions, _phi_count))) {
+		++_phi_count;
+	}
+}
 
-	vector<Edge*>::iterator it, it2;
-	for (it = _outgoing.begin(); it < _outgoing.end(); ++it) {
-		if ((*it)->to == other) {
-			for (it2 = other->_incoming.begin(); it2 < other->_incoming.end(); ++it2) {
-				if ((*it2)->from == this) {
-					Edge* ptr = *it;
-					_outgoing.erase(it);
-					other->_incoming.erase(it2);
-					delete ptr;
-					
-					clear_cache();
-					other->clear_cache();
-					return;
-				}
-			}
-			break;
+void BasicBlock::unshift_phi(VALUE phi) {
+	long count = phi_count();
+	rb_ary_unshift(_instructions, phi);
+	_phi_count = count + 1;
+}
+
+void BasicBlock::settle_phis() {
+	long count = phi_count();
+	long kept = 0;
+	while (kept < count && is_phi(rb_ary_entry(_instructions, kept))) {
+		++kept;
+	}
+	if (kept == count) {
+		return;
+	}
+	VALUE prefix = rb_ary_subseq(_instructions, kept, count - kept);
+	long length = RARRAY_LEN(prefix);
+	for (long i = 0; i < length; ++i) {
+		VALUE instruction = rb_ary_entry(prefix, i);
+		if (is_phi(instruction)) {
+			rb_ary_store(_instructions, kept++, instruction);
+		}
+	}
+	_phi_count = kept;
+	for (long i = 0; i < length; ++i) {
+		VALUE instruction = rb_ary_entry(prefix, i);
+		if (!is_phi(instruction)) {
+			rb_ary_store(_instructions, kept++, instruction);
 		}
 	}
-	throw NoSuchEdgeException();
+	RB_GC_GUARD(prefix);
 }
 
-void BasicBlock::insert_block_on_edge(BasicBlock* successor, BasicBlock* inserted) {
-	using namespace std;
-	vector<Edge*>::iterator it, it2;
-	for (it = _outgoing.begin(); it < _outgoing.end(); ++it) {
-		if ((*it)->to == successor) {
-			for (it2 = successor->_incoming.begin(); it2 < successor->_incoming.end(); ++it2) {
-				if ((*it2)->from == this) {
-					Edge* old_edge = *it;
-					*it = new Edge(this, inserted);
-					*it2 = new Edge(inserted, successor);
-					// we should place the flags of the replaced edge on just the
-					// first new edge
-					(*it)->flags = old_edge->flags;
-					inserted->predecessors().push_back(*it);
-					inserted->successors().push_back(*it2);
-					delete old_edge;
-					
-					clear_cache();
-					inserted->clear_cache();
-					successor->clear_cache();
-					return;
-				}
+void BasicBlock::push_outgoing(Edge* edge) {
+	if (find_edge(edge->to)) {
+		++_parallel_edges;
+	}
+	edge->out_pos = _outgoing.size();
+	_outgoing.push_back(edge);
+	if (_edge_index) {
+		_edge_index->insert(std::make_pair(edge->to, edge));
+	} else {
+		index_edges();
+	}
+}
+
+// Builds the successor index if the block is wide enough to need one.
+void BasicBlock::index_edges() {
+	if (_edge_index || _outgoing.size() <= EDGE_INDEX_THRESHOLD) {
+		return;
+	}
+	_edge_index = new std::unordered_map<BasicBlock*, Edge*>;
+	for (std::vector<Edge*>::iterator it = _outgoing.begin(); it < _outgoing.end(); ++it) {
+		_edge_index->insert(std::make_pair((*it)->to, *it));
+	}
+}
+
+void BasicBlock::push_incoming(Edge* edge) {
+	edge->in_pos = _incoming.size();
+	_incoming.push_back(edge);
+}
+
+void BasicBlock::remove_outgoing(Edge* edge) {
+	Edge* last = _outgoing.back();
+	_outgoing[edge->out_pos] = last;
+	last->out_pos = edge->out_pos;
+	_outgoing.pop_back();
+	if (_outgoing.empty()) {
+		_parallel_edges = 0;
+	}
+	unindex_edge(edge);
+}
+
+// Drops the edge from the successor index, falling back to a parallel edge
+// to the same block if one might exist. The edge must be out of _outgoing.
+void BasicBlock::unindex_edge(Edge* edge) {
+	if (!_edge_index) {
+		return;
+	}
+	std::unordered_map<BasicBlock*, Edge*>::iterator entry = _edge_index->find(edge->to);
+	if (entry == _edge_index->end() || entry->second != edge) {
+		return;
+	}
+	_edge_index->erase(entry);
+	if (_parallel_edges) {
+		for (std::vector<Edge*>::iterator it = _outgoing.begin(); it < _outgoing.end(); ++it) {
+			if ((*it)->to == edge->to) {
+				_edge_index->insert(std::make_pair(edge->to, *it));
+				return;
 			}
-			break;
 		}
 	}
-	throw NoSuchEdgeException();
+}
+
+void BasicBlock::remove_incoming(Edge* edge) {
+	Edge* last = _incoming.back();
+	_incoming[edge->in_pos] = last;
+	last->in_pos = edge->in_pos;
+	_incoming.pop_back();
+}
+
+void BasicBlock::join(BasicBlock *other, uint8_t flags) {
+	clear_edge_cache();
+	other->clear_edge_cache();
+	connect(other, flags);
+	IncrementalDominators::edge_added(this, other, flags);
+}
+
+BasicBlock::Edge* BasicBlock::connect(BasicBlock *other, uint8_t flags) {
+	Edge *new_edge = allocate_edge(this, other, flags);
+	push_outgoing(new_edge);
+	other->push_incoming(new_edge);
+	return new_edge;
+}
+
+// Disconnects the block as the source in an edge
+void BasicBlock::disconnect(BasicBlock *other) {
+	remove_edge(&edge_to(other));
+}
+
+// The two new edges take the old edge's places in this block's successors
+// and the successor's predecessors, so phi nodes in the successor line up.
+void BasicBlock::insert_block_on_edge(BasicBlock* successor, BasicBlock* inserted) {
+	Edge* old_edge = &edge_to(successor);
+	uint8_t old_flags = old_edge->flags;
+	// we should place the flags of the replaced edge on just the
+	// first new edge
+	Edge* first = allocate_edge(this, inserted, old_edge->flags);
+	Edge* second = allocate_edge(inserted, successor, 0);
+
+	if (find_edge(inserted)) {
+		++_parallel_edges;
+	}
+	first->out_pos = old_edge->out_pos;
+	_outgoing[first->out_pos] = first;
+	unindex_edge(old_edge);
+	if (_edge_index) {
+		_edge_index->insert(std::make_pair(inserted, first));
+	}
+	second->in_pos = old_edge->in_pos;
+	successor->_incoming[second->in_pos] = second;
+
+	inserted->push_incoming(first);
+	inserted->push_outgoing(second);
+	free_edge(old_edge);
+
+	clear_edge_cache();
+	inserted->clear_edge_cache();
+	successor->clear_edge_cache();
+	IncrementalDominators::block_inserted(this, inserted, successor, old_flags);
 }
 
 void BasicBlock::clear_edges() {
 	while (!_outgoing.empty()) {
-		BasicBlock::Edge* edge = _outgoing.back();
-		disconnect(edge->to);
+		remove_edge(_outgoing.back());
 	}
 	while (!_incoming.empty()) {
-		BasicBlock::Edge* edge = _incoming.back();
-		edge->from->disconnect(this);
+		remove_edge(_incoming.back());
+	}
+}
+
+void BasicBlock::clear_cache() {
+	clear_edge_cache();
+	if (_graph) {
+		_graph->invalidate_dominators();
+	}
+}
+
+void BasicBlock::clear_edge_cache() {
+	++_generation;
+	if (_graph) {
+		_graph->invalidate_traversal();
+	}
+}
+
+// Only a change to the fake bit changes which edges are real, so any other
+// flag change leaves the traversal, and the analyses keyed by its edge
+// generation, alone: it only stales the two blocks' filtered views.
+void BasicBlock::change_flags(Edge& edge, uint8_t flags) {
+	if (_graph && _graph->overlay()) {
+		_graph->overlay()->record(&edge);
+	}
+	uint8_t old_flags = edge.flags;
+	edge.flags = flags;
+	if (((old_flags ^ flags) & EDGE_FAKE) == 0) {
+		++_generation;
+		++edge.to->_generation;
+		return;
+	}
+	clear_edge_cache();
+	edge.to->clear_edge_cache();
+	if (flags & EDGE_FAKE) {
+		IncrementalDominators::edge_removed(this, edge.to, old_flags);
+	} else {
+		IncrementalDominators::edge_added(this, edge.to, flags);
 	}
 }
 
@@ -96,59 +329,122 @@ bool BasicBlock::has_flag(BasicBlock* dest, uint8_t flag) {
 	return ((edge_to(dest).flags & flag) != 0);
 }
 void BasicBlock::add_flag(BasicBlock* dest, uint8_t flag) {
-	clear_cache();
-	dest->clear_cache();
-	edge_to(dest).flags |= flag;
+	Edge& edge = edge_to(dest);
+	change_flags(edge, edge.flags | flag);
 }
 void BasicBlock::set_flag(BasicBlock* dest, uint8_t flag) {
-	clear_cache();
-	dest->clear_cache();
-	edge_to(dest).flags = flag;
+	change_flags(edge_to(dest), flag);
 }
 void BasicBlock::remove_flag(BasicBlock* dest, uint8_t flag) {
-	clear_cache();
-	dest->clear_cache();
-	edge_to(dest).flags &= ~flag;
+	Edge& edge = edge_to(dest);
+	change_flags(edge, edge.flags & ~flag);
+}
+bool BasicBlock::mark_executable(BasicBlock* dest) {
+	Edge& edge = edge_to(dest);
+	if (edge.flags & (EDGE_EXECUTABLE | EDGE_FAKE)) {
+		return false;
+	}
+	if (_graph && _graph->overlay()) {
+		_graph->overlay()->record(&edge);
+	}
+	edge.flags |= EDGE_EXECUTABLE;
+	++_generation;
+	++dest->_generation;
+	return true;
 }
 
-BasicBlock::Edge& BasicBlock::edge_to(BasicBlock* dest) {
+BasicBlock::Edge* BasicBlock::find_edge(BasicBlock* dest) {
 	using namespace std;
+	if (_edge_index) {
+		unordered_map<BasicBlock*, Edge*>::iterator entry = _edge_index->find(dest);
+		return (entry == _edge_index->end()) ? NULL : entry->second;
+	}
+	++native_counters.edge_scans;
 	for (vector<Edge*>::iterator it = _outgoing.begin(); it < _outgoing.end(); ++it) {
+		++native_counters.edge_scan_steps;
 		if ((*it)->to == dest) {
-			return **it;
+			return *it;
 		}
 	}
-	throw NoSuchEdgeException();
+	return NULL;
+}
+
+BasicBlock::Edge& BasicBlock::edge_to(BasicBlock* dest) {
+	Edge* edge = find_edge(dest);
+	if (!edge) {
+		throw NoSuchEdgeException();
+	}
+	return *edge;
+}
+
+// A graph marks each of its vertices, and each block keeps its graph's
+// wrapper alive, so references between vertices of one graph need no
+// marking of their own. Only edges leaving the graph are followed, from
+// whichever end is reached.
+void BasicBlock::mark_neighbour(BasicBlock* other) {
+	if (!_graph || !_graph->has_vertex(other)) {
+		rb_gc_mark_movable(other->representation());
+	}
 }
 
 void BasicBlock::mark() {
 	using namespace std;
-	rb_gc_mark(_instructions);
-	rb_gc_mark(_name);
-	rb_gc_mark(_post_order_number);
-	rb_gc_mark(_representation);
+	rb_gc_mark_movable(_instructions);
+	rb_gc_mark_movable(_name);
+	if (_graph) {
+		rb_gc_mark_movable(_graph->representation());
+	}
 	for (vector<Edge*>::iterator it = _outgoing.begin(); it < _outgoing.end(); ++it) {
-		BasicBlock *other = (*it)->to;
-		rb_gc_mark(other->representation());
+		mark_neighbour((*it)->to);
 	}
 	for (vector<Edge*>::iterator it = _incoming.begin(); it < _incoming.end(); ++it) {
-		BasicBlock *other = (*it)->from;
-		rb_gc_mark(other->representation());
+		mark_neighbour((*it)->from);
 	}
-	if (_cache_flags & EDGE_ALL_SUCC) {
-		rb_gc_mark(_cached_successors);
+	if (_idom) {
+		mark_neighbour(_idom);
 	}
-	if (_cache_flags & EDGE_REAL_SUCC) {
-		rb_gc_mark(_cached_real_successors);
+	if (_dom_root) {
+		mark_neighbour(_dom_root);
 	}
-	if (_cache_flags & EDGE_ALL_PRED) {
-		rb_gc_mark(_cached_predecessors);
+	for (vector<BasicBlock*>::iterator it = _dominated.begin(); it < _dominated.end(); ++it) {
+		mark_neighbour(*it);
 	}
-	if (_cache_flags & EDGE_REAL_PRED) {
-		rb_gc_mark(_cached_real_predecessors);
+	for (vector<BasicBlock*>::iterator it = _dom_order.begin(); it < _dom_order.end(); ++it) {
+		mark_neighbour(*it);
+	}
+	for (int slot = 0; slot < 2 * NUM_EDGE_FILTERS; ++slot) {
+		if (_view_generations[slot] == _generation) {
+			rb_gc_mark_movable(_views[slot]);
+		}
+	}
+}
+
+// Neighbours are reached through their own _representation, which their
+// own compaction updates.
+void BasicBlock::compact() {
+	_instructions = rb_gc_location(_instructions);
+	_name = rb_gc_location(_name);
+	_representation = rb_gc_location(_representation);
+	for (int slot = 0; slot < 2 * NUM_EDGE_FILTERS; ++slot) {
+		if (_view_generations[slot] == _generation) {
+			_views[slot] = rb_gc_location(_views[slot]);
+		}
 	}
 }
 
+size_t BasicBlock::memsize() {
+	size_t size = sizeof(BasicBlock);
+	size += (_incoming.capacity() + _outgoing.capacity()) * sizeof(Edge*);
+	size += _outgoing.size() * sizeof(Edge);
+	size += (_dominated.capacity() + _dom_order.capacity()) * sizeof(BasicBlock*);
+	size += _frontier.memsize();
+	if (_edge_index) {
+		size += sizeof(*_edge_index) + _edge_index->bucket_count() * sizeof(void*);
+		size += _edge_index->size() * (sizeof(std::pair<BasicBlock*, Edge*>) + sizeof(void*));
+	}
+	return size;
+}
+
 extern "C" {
 	#define NO_EDGE_MESSAGE "The given edge does not exist."
 	static void bb_mark(void* p) {
@@ -158,44 +454,68 @@ extern "C" {
 
 	static void bb_free(void* p) {
 		BasicBlock *block = (BasicBlock*)p;
+		if (block->graph()) {
+			// Owned by the graph, which frees its blocks all at once.
+			block->graph()->release();
+			return;
+		}
 		block->clear_edges();
 		delete block;
 	}
 
+	static size_t bb_memsize(const void* p) {
+		return ((BasicBlock*)p)->memsize();
+	}
+
+	static void bb_compact(void* p) {
+		((BasicBlock*)p)->compact();
+	}
+
+	const rb_data_type_t basic_block_type = {
+		"Laser::Analysis::ControlFlow::BasicBlock",
+		{ bb_mark, bb_free, bb_memsize, LASER_DCOMPACT(bb_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
 	static VALUE bb_alloc(VALUE klass) {
 		BasicBlock *block = new BasicBlock;
-	    VALUE result = Data_Wrap_Struct(klass, bb_mark, bb_free, block);
+		// Nothing marks the new instruction array until the block is wrapped.
+		VALUE instructions = block->instructions();
+		VALUE result = TypedData_Wrap_Struct(klass, &basic_block_type, block);
+		RB_GC_GUARD(instructions);
 		block->set_representation(result);
 		return result;
 	}
 	
 	static VALUE bb_dup(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		BasicBlock *result_block = new BasicBlock(*block);
-		VALUE result = Data_Wrap_Struct(rb_cBasicBlock, bb_mark, bb_free, result_block);
-		block->set_representation(result);
+		VALUE instructions = result_block->instructions();
+		VALUE result = TypedData_Wrap_Struct(rb_obj_class(self), &basic_block_type, result_block);
+		RB_GC_GUARD(instructions);
+		result_block->set_representation(result);
 		return result;
 	}
 
 	static VALUE bb_initialize(VALUE self, VALUE name) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		block->set_name(name);
 		return Qnil;
 	}
 	
 	static VALUE bb_equal(VALUE self, VALUE other) {
 		BasicBlock *block, *other_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(other, BasicBlock, other_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(other, BasicBlock, &basic_block_type, other_block);
 		return (block == other_block) ? Qtrue : Qfalse;
 	}
 
 	static VALUE bb_eql(VALUE self, VALUE other) {
 		BasicBlock *block, *other_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(other, BasicBlock, other_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(other, BasicBlock, &basic_block_type, other_block);
 		return (block == other_block ||
 		        (rb_str_cmp(block->name(), other_block->name()) == 0)) ? Qtrue : Qfalse;
 	}
@@ -206,13 +526,13 @@ extern "C" {
 	
 	static VALUE bb_hash(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		return INT2FIX((unsigned long int)block);
 	}
 
 	static VALUE bb_clear_edges(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		try {
 			block->clear_edges();
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -223,40 +543,88 @@ extern "C" {
 
 	static VALUE bb_get_name(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		return block->name();
 	}
 
+	static VALUE bb_get_id(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		return (block->id() == BasicBlock::NO_ID) ? Qnil : UINT2NUM(block->id());
+	}
+
 	static VALUE bb_get_instructions(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
 		return block->instructions();
 	}
 
 	static VALUE bb_set_instructions(VALUE self, VALUE new_insns) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		Check_Type(new_insns, T_ARRAY);
 		block->set_instructions(new_insns);
 		return Qnil;
 	}
 
-	static VALUE bb_get_post_order_number(VALUE self) {
+	static VALUE bb_phi_count(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		return block->post_order_number();
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		return LONG2NUM(block->phi_count());
 	}
 
-	static VALUE bb_set_post_order_number(VALUE self, VALUE new_num) {
+	// The phi nodes and the rest, as Arrays sharing the instructions' storage.
+	static VALUE bb_phi_nodes(VALUE self) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		block->set_post_order_number(new_num);
-		return Qnil;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		return rb_ary_subseq(block->instructions(), 0, block->phi_count());
 	}
-	
+
+	static VALUE bb_natural_instructions(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		long count = block->phi_count();
+		return rb_ary_subseq(block->instructions(), count, RARRAY_LEN(block->instructions()) - count);
+	}
+
+	static VALUE bb_each_phi(VALUE self) {
+		RETURN_ENUMERATOR(self, 0, 0);
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		for (long i = 0; i < block->phi_count(); ++i) {
+			rb_yield(rb_ary_entry(block->instructions(), i));
+		}
+		return self;
+	}
+
+	static VALUE bb_each_natural_instruction(VALUE self) {
+		RETURN_ENUMERATOR(self, 0, 0);
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		for (long i = block->phi_count(); i < RARRAY_LEN(block->instructions()); ++i) {
+			rb_yield(rb_ary_entry(block->instructions(), i));
+		}
+		return self;
+	}
+
+	static VALUE bb_unshift_phi(VALUE self, VALUE phi) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		block->unshift_phi(phi);
+		return self;
+	}
+
+	static VALUE bb_settle_phis(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		block->settle_phis();
+		return self;
+	}
+
 	static VALUE bb_get_flags(VALUE self, VALUE dest) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			return INT2FIX(block->get_flags(dest_block));
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -266,8 +634,8 @@ extern "C" {
 	
 	static VALUE bb_has_flag(VALUE self, VALUE dest, VALUE flag) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			return (block->has_flag(dest_block, FIX2INT(flag)) ? Qtrue : Qfalse);
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -277,8 +645,8 @@ extern "C" {
 	
 	static VALUE bb_add_flag(VALUE self, VALUE dest, VALUE flag) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			block->add_flag(dest_block, FIX2INT(flag));
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -289,8 +657,8 @@ extern "C" {
 	
 	static VALUE bb_set_flag(VALUE self, VALUE dest, VALUE flag) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			block->set_flag(dest_block, FIX2INT(flag));
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -301,8 +669,8 @@ extern "C" {
 	
 	static VALUE bb_remove_flag(VALUE self, VALUE dest, VALUE flag) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			block->remove_flag(dest_block, FIX2INT(flag));
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -313,16 +681,16 @@ extern "C" {
 
 	static VALUE bb_join(VALUE self, VALUE dest) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		block->join(dest_block);
 		return Qnil;
 	}
 
 	static VALUE bb_disconnect(VALUE self, VALUE dest) {
 		BasicBlock *block, *dest_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(dest, BasicBlock, dest_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(dest, BasicBlock, &basic_block_type, dest_block);
 		try	{
 			block->disconnect(dest_block);
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -333,9 +701,9 @@ extern "C" {
 
 	static VALUE bb_insert_block_on_edge(VALUE self, VALUE succ, VALUE inserted) {
 		BasicBlock *block, *succ_block, *inserted_block;
-		Data_Get_Struct(self, BasicBlock, block);
-		Data_Get_Struct(succ, BasicBlock, succ_block);
-		Data_Get_Struct(inserted, BasicBlock, inserted_block);
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(succ, BasicBlock, &basic_block_type, succ_block);
+		TypedData_Get_Struct(inserted, BasicBlock, &basic_block_type, inserted_block);
 		try	{
 			block->insert_block_on_edge(succ_block, inserted_block);
 		} catch (BasicBlock::NoSuchEdgeException e) {
@@ -344,182 +712,180 @@ extern "C" {
 		return Qnil;
 	}
 
-	static VALUE bb_successors(VALUE self) {
-		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		VALUE result;
-		if ((result = block->cached_successors()) && result != Qnil) {
-			return result;
-		}
-		std::vector<BasicBlock::Edge*>& list = block->successors();
+	/*    FILTERED NEIGHBOURS    */
 
-		result = rb_ary_new();
-		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin();
-			 it < list.end();
-			 ++it) {
-			rb_ary_push(result, (*it)->to->representation());
-		}
-		block->set_cached_successors(result);
-		return result;
+	static inline BasicBlock* bb_neighbour(BasicBlock::Edge* edge, bool outgoing) {
+		return outgoing ? edge->to : edge->from;
 	}
-	
-	static VALUE bb_predecessors(VALUE self) {
+
+	// The frozen Array of neighbours across edges passing the filter,
+	// cached on the block until its edges change.
+	static VALUE bb_filtered_view(VALUE self, bool outgoing, edge_filter filter) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		VALUE result;
-		if ((result = block->cached_predecessors()) && result != Qnil) {
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		VALUE result = block->cached_view(outgoing, filter);
+		if (result != Qnil) {
+			++native_counters.view_hits;
 			return result;
 		}
-		std::vector<BasicBlock::Edge*>& list = block->predecessors();
-		
-		result = rb_ary_new();
+		++native_counters.view_misses;
+		++native_counters.arrays_allocated;
+		std::vector<BasicBlock::Edge*>& list = outgoing ? block->successors() : block->predecessors();
+		const EdgeFilter& test = edge_filters[filter];
+		result = rb_ary_new2(list.size());
 		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin();
 			 it < list.end();
 			 ++it) {
-			rb_ary_push(result, (*it)->from->representation());
-		}
-		block->set_cached_predecessors(result);
-		return result;
-	}
-
-	/*    FILTERED PREDECESSORS    */
-
-	static VALUE bb_filtered_predecessors(VALUE self, uint8_t flag, uint8_t expectation) {
-		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		std::vector<BasicBlock::Edge*>& list = block->predecessors();
-		
-		VALUE result = rb_ary_new();
-		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin();
-			 it < list.end();
-			 ++it) {
-			if (((*it)->flags & flag) == expectation) {
-				rb_ary_push(result, (*it)->from->representation());
+			if (test.passes((*it)->flags)) {
+				rb_ary_push(result, bb_neighbour(*it, outgoing)->representation());
 			}
 		}
+		rb_obj_freeze(result);
+		block->set_cached_view(outgoing, filter, result);
 		return result;
 	}
 
-	static VALUE bb_real_predecessors(VALUE self) {
+	// Yields without building an Array. The list is walked by index and
+	// re-checked each step, so a block that changes the edges cannot make
+	// the walk read past the end.
+	static VALUE bb_each_filtered(VALUE self, bool outgoing, edge_filter filter) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		VALUE result;
-		if ((result = block->cached_real_predecessors()) && result != Qnil) {
-			return result;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		VALUE cached = block->cached_view(outgoing, filter);
+		if (cached != Qnil) {
+			return rb_ary_each(cached);
 		}
-		result = bb_filtered_predecessors(self, EDGE_FAKE, 0);
-		block->set_cached_real_predecessors(result);
-		return result;
-	}
-	
-	static VALUE bb_normal_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_ABNORMAL, 0);
-	}
-
-	static VALUE bb_abnormal_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_ABNORMAL, EDGE_ABNORMAL);
-	}
-
-	static VALUE bb_block_taken_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_BLOCK_TAKEN, EDGE_BLOCK_TAKEN);
-	}
-
-	static VALUE bb_exception_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_ABNORMAL | EDGE_BLOCK_TAKEN, EDGE_ABNORMAL);
-	}
-
-	static VALUE bb_executed_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_EXECUTABLE, EDGE_EXECUTABLE);
-	}
-
-	static VALUE bb_unexecuted_predecessors(VALUE self) {
-		return bb_filtered_predecessors(self, EDGE_EXECUTABLE, 0);
+		std::vector<BasicBlock::Edge*>& list = outgoing ? block->successors() : block->predecessors();
+		const EdgeFilter& test = edge_filters[filter];
+		for (size_t i = 0; i < list.size(); ++i) {
+			if (test.passes(list[i]->flags)) {
+				rb_yield(bb_neighbour(list[i], outgoing)->representation());
+			}
+		}
+		return self;
 	}
 
-	/*    FILTERED SUCCESSORS    */
-
-	static VALUE bb_filtered_successors(VALUE self, uint8_t flag, uint8_t expectation) {
+	static VALUE bb_any_filtered(VALUE self, bool outgoing, edge_filter filter) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		std::vector<BasicBlock::Edge*>& list = block->successors();
-		
-		VALUE result = rb_ary_new();
-		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin();
-			 it < list.end();
-			 ++it) {
-			if (((*it)->flags & flag) == expectation) {
-				rb_ary_push(result, (*it)->to->representation());
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		std::vector<BasicBlock::Edge*>& list = outgoing ? block->successors() : block->predecessors();
+		const EdgeFilter& test = edge_filters[filter];
+		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin(); it < list.end(); ++it) {
+			if (test.passes((*it)->flags)) {
+				return Qtrue;
 			}
 		}
-		return result;
+		return Qfalse;
 	}
 
-	static VALUE bb_real_successors(VALUE self) {
-		VALUE result;
+	static VALUE bb_count_filtered(VALUE self, bool outgoing, edge_filter filter) {
 		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		if ((result = block->cached_real_successors()) && result != Qnil) {
-			return result;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		std::vector<BasicBlock::Edge*>& list = outgoing ? block->successors() : block->predecessors();
+		const EdgeFilter& test = edge_filters[filter];
+		long count = 0;
+		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin(); it < list.end(); ++it) {
+			if (test.passes((*it)->flags)) {
+				++count;
+			}
 		}
-		result = bb_filtered_successors(self, EDGE_FAKE, 0);
-		block->set_cached_real_successors(result);
-		return result;
-	}
-	
-	static VALUE bb_normal_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_ABNORMAL, 0);
+		return LONG2NUM(count);
 	}
 
-	static VALUE bb_abnormal_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_ABNORMAL, EDGE_ABNORMAL);
+	static VALUE bb_successors(VALUE self) {
+		return bb_filtered_view(self, true, FILTER_ALL);
 	}
 
-	static VALUE bb_block_taken_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_BLOCK_TAKEN, EDGE_BLOCK_TAKEN);
-	}
+	static VALUE bb_predecessors(VALUE self) {
+		return bb_filtered_view(self, false, FILTER_ALL);
+	}
+
+	// Defines, for one filter, the cached Array, enumerator, predicate and
+	// count methods in both directions: real_successors,
+	// each_real_successors, any_real_successor?, real_successor_count, and
+	// the same for predecessors.
+	#define DEFINE_EDGE_FILTER(name, filter) \
+		static VALUE bb_##name##_successors(VALUE self) { \
+			return bb_filtered_view(self, true, filter); \
+		} \
+		static VALUE bb_##name##_predecessors(VALUE self) { \
+			return bb_filtered_view(self, false, filter); \
+		} \
+		static VALUE bb_each_##name##_successors(VALUE self) { \
+			RETURN_ENUMERATOR(self, 0, 0); \
+			return bb_each_filtered(self, true, filter); \
+		} \
+		static VALUE bb_each_##name##_predecessors(VALUE self) { \
+			RETURN_ENUMERATOR(self, 0, 0); \
+			return bb_each_filtered(self, false, filter); \
+		} \
+		static VALUE bb_any_##name##_successor(VALUE self) { \
+			return bb_any_filtered(self, true, filter); \
+		} \
+		static VALUE bb_any_##name##_predecessor(VALUE self) { \
+			return bb_any_filtered(self, false, filter); \
+		} \
+		static VALUE bb_##name##_successor_count(VALUE self) { \
+			return bb_count_filtered(self, true, filter); \
+		} \
+		static VALUE bb_##name##_predecessor_count(VALUE self) { \
+			return bb_count_filtered(self, false, filter); \
+		}
 
-	static VALUE bb_exception_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_ABNORMAL | EDGE_BLOCK_TAKEN, EDGE_ABNORMAL);
-	}
+	DEFINE_EDGE_FILTER(real, FILTER_REAL)
+	DEFINE_EDGE_FILTER(normal, FILTER_NORMAL)
+	DEFINE_EDGE_FILTER(abnormal, FILTER_ABNORMAL)
+	DEFINE_EDGE_FILTER(block_taken, FILTER_BLOCK_TAKEN)
+	DEFINE_EDGE_FILTER(exception, FILTER_EXCEPTION)
+	DEFINE_EDGE_FILTER(executed, FILTER_EXECUTED)
+	DEFINE_EDGE_FILTER(unexecuted, FILTER_UNEXECUTED)
+	#undef DEFINE_EDGE_FILTER
+
+	#define REGISTER_EDGE_FILTER(name) \
+		rb_define_method(rb_cBasicBlock, #name "_successors", RUBY_METHOD_FUNC(bb_##name##_successors), 0); \
+		rb_define_method(rb_cBasicBlock, #name "_predecessors", RUBY_METHOD_FUNC(bb_##name##_predecessors), 0); \
+		rb_define_method(rb_cBasicBlock, "each_" #name "_successors", RUBY_METHOD_FUNC(bb_each_##name##_successors), 0); \
+		rb_define_method(rb_cBasicBlock, "each_" #name "_predecessors", RUBY_METHOD_FUNC(bb_each_##name##_predecessors), 0); \
+		rb_define_method(rb_cBasicBlock, "any_" #name "_successor?", RUBY_METHOD_FUNC(bb_any_##name##_successor), 0); \
+		rb_define_method(rb_cBasicBlock, "any_" #name "_predecessor?", RUBY_METHOD_FUNC(bb_any_##name##_predecessor), 0); \
+		rb_define_method(rb_cBasicBlock, #name "_successor_count", RUBY_METHOD_FUNC(bb_##name##_successor_count), 0); \
+		rb_define_method(rb_cBasicBlock, #name "_predecessor_count", RUBY_METHOD_FUNC(bb_##name##_predecessor_count), 0);
 
-	static VALUE bb_executed_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_EXECUTABLE, EDGE_EXECUTABLE);
-	}
+	#undef NO_EDGE_MESSAGE
 
-	static VALUE bb_unexecuted_successors(VALUE self) {
-		return bb_filtered_successors(self, EDGE_EXECUTABLE, 0);
+	/*    NATIVE COUNTERS    */
+
+	#define COUNTER_ENTRY(name) \
+		rb_hash_aset(result, ID2SYM(rb_intern(#name)), ULL2NUM(native_counters.name));
+
+	// ControlFlow.native_counters returns a Hash of the edge storage's
+	// running totals since the last reset.
+	static VALUE cf_native_counters(VALUE self) {
+		VALUE result = rb_hash_new();
+		COUNTER_ENTRY(edges_created)
+		COUNTER_ENTRY(edges_destroyed)
+		COUNTER_ENTRY(edge_scans)
+		COUNTER_ENTRY(edge_scan_steps)
+		COUNTER_ENTRY(view_hits)
+		COUNTER_ENTRY(view_misses)
+		COUNTER_ENTRY(arrays_allocated)
+		return result;
 	}
+	#undef COUNTER_ENTRY
 
-	/* Optimized enumerator form */
-
-	static VALUE bb_each_real_predecessors(VALUE self) {
-		RETURN_ENUMERATOR(self, 0, 0);
-		BasicBlock *block;
-		Data_Get_Struct(self, BasicBlock, block);
-		VALUE result;
-		if ((result = block->cached_real_predecessors()) && result != Qnil) {
-			return rb_ary_each(result);
-		}
-		std::vector<BasicBlock::Edge*>& list = block->predecessors();
-
-		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin();
-			 it < list.end();
-			 ++it) {
-			if (((*it)->flags & EDGE_FAKE) == 0) {
-				rb_yield((*it)->from->representation());
-			}
-		}
+	static VALUE cf_reset_native_counters(VALUE self) {
+		native_counters = NativeCounters();
 		return Qnil;
 	}
 
-	#undef NO_EDGE_MESSAGE
-
     VALUE Init_BasicBlock()
     {
         rb_mLaser = rb_define_module("Laser");
 		rb_mAnalysis = rb_define_module_under(rb_mLaser, "Analysis");
 		rb_mControlFlow = rb_define_module_under(rb_mAnalysis, "ControlFlow");
         rb_cBasicBlock = rb_define_class_under(rb_mControlFlow, "BasicBlock", rb_cObject);
+		id_body = rb_intern("@body");
+		sym_phi = ID2SYM(rb_intern("phi"));
         
         rb_define_alloc_func(rb_cBasicBlock, bb_alloc);
 		rb_define_method(rb_cBasicBlock, "initialize", RUBY_METHOD_FUNC(bb_initialize), 1);
@@ -533,10 +899,16 @@ extern "C" {
 		rb_define_method(rb_cBasicBlock, "clear_edges", RUBY_METHOD_FUNC(bb_clear_edges), 0);
 		rb_define_method(rb_cBasicBlock, "name=", RUBY_METHOD_FUNC(bb_initialize), 1);
 		rb_define_method(rb_cBasicBlock, "name", RUBY_METHOD_FUNC(bb_get_name), 0);
+		rb_define_method(rb_cBasicBlock, "id", RUBY_METHOD_FUNC(bb_get_id), 0);
 		rb_define_method(rb_cBasicBlock, "instructions=", RUBY_METHOD_FUNC(bb_set_instructions), 1);
 		rb_define_method(rb_cBasicBlock, "instructions", RUBY_METHOD_FUNC(bb_get_instructions), 0);
-		rb_define_method(rb_cBasicBlock, "post_order_number=", RUBY_METHOD_FUNC(bb_set_post_order_number), 1);
-		rb_define_method(rb_cBasicBlock, "post_order_number", RUBY_METHOD_FUNC(bb_get_post_order_number), 0);
+		rb_define_method(rb_cBasicBlock, "phi_count", RUBY_METHOD_FUNC(bb_phi_count), 0);
+		rb_define_method(rb_cBasicBlock, "phi_nodes", RUBY_METHOD_FUNC(bb_phi_nodes), 0);
+		rb_define_method(rb_cBasicBlock, "natural_instructions", RUBY_METHOD_FUNC(bb_natural_instructions), 0);
+		rb_define_method(rb_cBasicBlock, "each_phi", RUBY_METHOD_FUNC(bb_each_phi), 0);
+		rb_define_method(rb_cBasicBlock, "each_natural_instruction", RUBY_METHOD_FUNC(bb_each_natural_instruction), 0);
+		rb_define_method(rb_cBasicBlock, "unshift_phi", RUBY_METHOD_FUNC(bb_unshift_phi), 1);
+		rb_define_method(rb_cBasicBlock, "settle_phis", RUBY_METHOD_FUNC(bb_settle_phis), 0);
 
 		rb_define_method(rb_cBasicBlock, "get_flags", RUBY_METHOD_FUNC(bb_get_flags), 1);
 		rb_define_method(rb_cBasicBlock, "has_flag?", RUBY_METHOD_FUNC(bb_has_flag), 2);
@@ -550,23 +922,27 @@ extern "C" {
 
 		rb_define_method(rb_cBasicBlock, "successors", RUBY_METHOD_FUNC(bb_successors), 0);
 		rb_define_method(rb_cBasicBlock, "predecessors", RUBY_METHOD_FUNC(bb_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "each_real_predecessors", RUBY_METHOD_FUNC(bb_each_real_predecessors), 0);
-		
-		rb_define_method(rb_cBasicBlock, "real_predecessors", RUBY_METHOD_FUNC(bb_real_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "normal_predecessors", RUBY_METHOD_FUNC(bb_normal_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "abnormal_predecessors", RUBY_METHOD_FUNC(bb_abnormal_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "block_taken_predecessors", RUBY_METHOD_FUNC(bb_block_taken_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "exception_predecessors", RUBY_METHOD_FUNC(bb_exception_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "executed_predecessors", RUBY_METHOD_FUNC(bb_executed_predecessors), 0);
-		rb_define_method(rb_cBasicBlock, "unexecuted_predecessors", RUBY_METHOD_FUNC(bb_unexecuted_predecessors), 0);
-		
-		rb_define_method(rb_cBasicBlock, "real_successors", RUBY_METHOD_FUNC(bb_real_successors), 0);
-		rb_define_method(rb_cBasicBlock, "normal_successors", RUBY_METHOD_FUNC(bb_normal_successors), 0);
-		rb_define_method(rb_cBasicBlock, "abnormal_successors", RUBY_METHOD_FUNC(bb_abnormal_successors), 0);
-		rb_define_method(rb_cBasicBlock, "block_taken_successors", RUBY_METHOD_FUNC(bb_block_taken_successors), 0);
-		rb_define_method(rb_cBasicBlock, "exception_successors", RUBY_METHOD_FUNC(bb_exception_successors), 0);
-		rb_define_method(rb_cBasicBlock, "executed_successors", RUBY_METHOD_FUNC(bb_executed_successors), 0);
-		rb_define_method(rb_cBasicBlock, "unexecuted_successors", RUBY_METHOD_FUNC(bb_unexecuted_successors), 0);
+		REGISTER_EDGE_FILTER(real)
+		REGISTER_EDGE_FILTER(normal)
+		REGISTER_EDGE_FILTER(abnormal)
+		REGISTER_EDGE_FILTER(block_taken)
+		REGISTER_EDGE_FILTER(exception)
+		REGISTER_EDGE_FILTER(executed)
+		REGISTER_EDGE_FILTER(unexecuted)
+		#undef REGISTER_EDGE_FILTER
+
+		rb_define_singleton_method(rb_mControlFlow, "native_counters", RUBY_METHOD_FUNC(cf_native_counters), 0);
+		rb_define_singleton_method(rb_mControlFlow, "reset_native_counters", RUBY_METHOD_FUNC(cf_reset_native_counters), 0);
+
+		Init_ControlFlowGraph();
+		Init_Dominators();
+		Init_Liveness();
+		Init_ConstantPropagation();
+		Init_StaticSingleAssignment();
+		Init_Precompute();
+		Init_Overlay();
+		Init_Loops();
+		Init_Sets();
 		return Qnil;
 	}
 }
\ No newline at end of file
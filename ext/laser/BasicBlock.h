@@ -2,9 +2,21 @@
 #define LASER_BASIC_BLOCK_H_
 
 #include <vector>
+#include <unordered_map>
 #include <exception>
 #include <stdexcept>
 #include "ruby.h"
+#include "Bitset.h"
+
+// GC compaction arrived in Ruby 2.7. Before it, nothing moves, and the
+// dcompact slot of rb_data_type_t is reserved.
+#ifdef HAVE_RB_GC_MARK_MOVABLE
+#define LASER_DCOMPACT(function) (function)
+#else
+#define rb_gc_mark_movable(value) rb_gc_mark(value)
+#define rb_gc_location(value) (value)
+#define LASER_DCOMPACT(function) NULL
+#endif
 
 namespace Laser {
 	enum edge_flag {
@@ -14,19 +26,64 @@ namespace Laser {
 	    EDGE_EXECUTABLE = 1 << 3,
 	    EDGE_BLOCK_TAKEN = 1 << 4,
 	};
-	enum cache_flag {
-		EDGE_ALL_SUCC = 1 << 0,
-		EDGE_REAL_SUCC = 1 << 1,
-		EDGE_ALL_PRED = 1 << 2,
-		EDGE_REAL_PRED = 1 << 3,
+	// The ways edges are filtered when listing a block's neighbours: an
+	// edge passes if (flags & mask) == expectation for its filter.
+	enum edge_filter {
+		FILTER_ALL,
+		FILTER_REAL,
+		FILTER_NORMAL,
+		FILTER_ABNORMAL,
+		FILTER_BLOCK_TAKEN,
+		FILTER_EXCEPTION,
+		FILTER_EXECUTED,
+		FILTER_UNEXECUTED,
+		NUM_EDGE_FILTERS
+	};
+	struct EdgeFilter {
+		uint8_t mask;
+		uint8_t expectation;
+		inline bool passes(uint8_t flags) const { return (flags & mask) == expectation; }
+	};
+	extern const EdgeFilter edge_filters[NUM_EDGE_FILTERS];
+	// Running totals of the work done by the edge storage, reported by
+	// laser --stats. They are only bumped while holding the GVL, so plain
+	// increments are enough.
+	struct NativeCounters {
+		uint64_t edges_created;
+		uint64_t edges_destroyed;
+		// Lookups that scanned the outgoing list, and the edges they read.
+		uint64_t edge_scans;
+		uint64_t edge_scan_steps;
+		// Filtered views served from the block's cache, or rebuilt.
+		uint64_t view_hits;
+		uint64_t view_misses;
+		// Arrays built for cached queries: filtered views and traversals.
+		uint64_t arrays_allocated;
 	};
+	extern NativeCounters native_counters;
+	class ControlFlowGraph;
+	class DominatorSnapshot;
 	class BasicBlock {
 	  public:
 		struct Edge;
-		BasicBlock() : _name(NULL), _instructions(rb_ary_new()), _post_order_number(NULL), _cache_flags(0) {}
+		static const uint32_t NO_ID = ~(uint32_t)0;
+		BasicBlock() : _edge_index(NULL), _parallel_edges(0), _name(Qnil), _instructions(rb_ary_new()),
+		               _phi_count(0), _representation(Qnil), _generation(1), _view_generations(),
+		               _graph(NULL), _id(NO_ID), _preorder(NO_ID), _post_order(NO_ID), _dfs_parent(NULL),
+		               _idom(NULL), _dom_root(NULL), _dom_generation(0), _dom_numbered(false),
+		               _frontier_generation(0) {}
+		// Copies the name and instructions, but not edges or graph membership.
 		BasicBlock(BasicBlock& other);
+		~BasicBlock() { delete _edge_index; }
 		// Joins the block as a source to a destination
-		void join(BasicBlock* other);
+		void join(BasicBlock* other, uint8_t flags = 0);
+		// Joins without clearing any caches, for callers that add edges in
+		// bulk and clear the caches of the blocks they touched once at the end.
+		Edge* connect(BasicBlock* other, uint8_t flags);
+		inline void reserve_edges(size_t outgoing, size_t incoming) {
+			_outgoing.reserve(_outgoing.size() + outgoing);
+			_incoming.reserve(_incoming.size() + incoming);
+		}
 		// Disconnects the block as the source in an edge
 		void disconnect(BasicBlock* other);
 		// Adds a block on the given edge
@@ -36,83 +93,176 @@ namespace Laser {
 		inline VALUE name() { return _name; }
 		inline void set_name(VALUE name) { _name = name; }
 		inline VALUE instructions() { return _instructions; }
-		inline void set_instructions(VALUE instructions) { _instructions = instructions; }
-		inline VALUE post_order_number() { return _post_order_number; }
-		inline void set_post_order_number(VALUE post_order_number) { _post_order_number = post_order_number; }
+		// Sets the instructions, which must hold any phi nodes first.
+		void set_instructions(VALUE instructions);
+		// The phi nodes are a prefix of the instructions, tracked as they
+		// are set and as phi nodes are added, so the passes that handle phi
+		// nodes apart from the rest need not scan for them.
+		inline long phi_count() {
+			long length = RARRAY_LEN(_instructions);
+			return _phi_count < length ? _phi_count : length;
+		}
+		void unshift_phi(VALUE phi);
+		// Moves the prefix's instructions that are no longer phi nodes, as
+		// when removing an edge collapses one to an assignment, to just
+		// after the phi nodes, keeping their order.
+		void settle_phis();
 		inline VALUE representation() { return _representation; }
 		inline void set_representation(VALUE representation) { _representation = representation; }
 		inline std::vector<Edge*>& predecessors() { return _incoming; }
 		inline std::vector<Edge*>& successors() { return _outgoing; }
+
+		// The graph that owns this block, if any, and the block's ID in it.
+		// The ID is NO_ID once the block has been removed from the graph.
+		inline ControlFlowGraph* graph() { return _graph; }
+		inline uint32_t id() { return _id; }
+
+		// Depth-first numbering from the graph's entry over real edges, as of
+		// the last ControlFlowGraph::compute_traversal. Unreached blocks
+		// have NO_ID numbers and no parent.
+		inline uint32_t preorder_number() { return _preorder; }
+		inline uint32_t post_order_number() { return _post_order; }
+		inline BasicBlock* dfs_parent() { return _dfs_parent; }
+
+		// Dominator information, filled in by compute_dominators (Dominators.cpp).
+		// It is only meaningful while the block's generation matches its root's.
+		inline bool has_dominator_info() {
+			return _dom_root != NULL && _dom_root->_dom_generation == _dom_generation;
+		}
+		inline BasicBlock* idom() { return has_dominator_info() ? _idom : NULL; }
+		inline std::vector<BasicBlock*>& dominated_children() { return _dominated; }
+		bool dominates(BasicBlock* other);
+		inline BasicBlock* dominator_root() { return _dom_root; }
+		inline std::vector<BasicBlock*>& dominator_order() { return _dom_order; }
+		inline Bitset& dominance_frontier() { return _frontier; }
+		// On a tree's root: whether its blocks' frontiers match the tree.
+		inline bool frontiers_current() { return _frontier_generation == _dom_generation; }
 		
 		uint8_t get_flags(BasicBlock *dest);
 		bool has_flag(BasicBlock* dest, uint8_t flag);
 		void add_flag(BasicBlock* dest, uint8_t flag);
 		void set_flag(BasicBlock* dest, uint8_t flag);
 		void remove_flag(BasicBlock* dest, uint8_t flag);
+		// Flags the edge to dest executable unless it already is, or is fake.
+		// Returns true if it was newly flagged. Executability doesn't change
+		// which edges are real, so the graph's traversal is kept.
+		bool mark_executable(BasicBlock* dest);
 
+		// Marks the block's references as movable, and the neighbours that
+		// its graph doesn't already mark.
 		void mark();
+		// Updates the block's references after GC compaction.
+		void compact();
+		// The heap held by the block, counting each edge once, at its source.
+		size_t memsize();
 
-		inline uint8_t cache_flags() { return _cache_flags; }
-		inline void clear_cache() { _cache_flags = 0; }
-		inline VALUE cached_successors() {
-			return (_cache_flags & EDGE_ALL_SUCC) ? _cached_successors : Qnil;
-		}
-		inline void set_cached_successors(VALUE cached_successors) {
-			_cached_successors = cached_successors;
-			_cache_flags |= EDGE_ALL_SUCC;
+		// Drops the cached edge lists, and the owning graph's traversal and
+		// dominator tree.
+		void clear_cache();
+		// Like clear_cache, but keeps the dominator tree, for edits that
+		// update it through IncrementalDominators.
+		void clear_edge_cache();
+		// The cached, frozen Array of neighbours passing the filter, or Qnil
+		// if the edges have changed since it was built. Views are tagged with
+		// the block's generation, which clear_cache bumps.
+		inline VALUE cached_view(bool outgoing, edge_filter filter) {
+			int slot = view_slot(outgoing, filter);
+			return (_view_generations[slot] == _generation) ? _views[slot] : Qnil;
 		}
-		inline VALUE cached_real_successors() {
-			return (_cache_flags & EDGE_REAL_SUCC) ? _cached_real_successors : Qnil;
-		}
-		inline void set_cached_real_successors(VALUE cached_real_successors) {
-			_cached_real_successors = cached_real_successors;
-			_cache_flags |= EDGE_REAL_SUCC;
-		}
-		inline VALUE cached_predecessors() {
-			return (_cache_flags & EDGE_ALL_PRED) ? _cached_predecessors : Qnil;
-		}
-		inline void set_cached_predecessors(VALUE cached_predecessors) {
-			_cached_predecessors = cached_predecessors;
-			_cache_flags |= EDGE_ALL_PRED;
-		}
-		inline VALUE cached_real_predecessors() {
-			return (_cache_flags & EDGE_REAL_PRED) ? _cached_real_predecessors : Qnil;
-		}
-		inline void set_cached_real_predecessors(VALUE cached_real_predecessors) {
-			_cached_real_predecessors = cached_real_predecessors;
-			_cache_flags |= EDGE_REAL_PRED;
+		inline void set_cached_view(bool outgoing, edge_filter filter, VALUE view) {
+			int slot = view_slot(outgoing, filter);
+			_views[slot] = view;
+			_view_generations[slot] = _generation;
 		}
 
+		// Edges live in a process-wide pool of fixed-size slabs, so their
+		// addresses are stable and each has a 32-bit index. An edge records
+		// where it sits in both adjacency lists, which makes removal an O(1)
+		// swap with the last entry. Removal therefore reorders the lists.
 		struct Edge {
-			Edge(BasicBlock * const inFrom, BasicBlock * const inTo) : from(inFrom), to(inTo) {}
-
-			BasicBlock * const from;
-			BasicBlock * const to;
+			BasicBlock *from;
+			BasicBlock *to;
+			uint32_t index;
+			uint32_t out_pos;
+			// Position in to->_incoming; the next free index while pooled.
+			uint32_t in_pos;
 			uint8_t flags;
 		};
+		static Edge* allocate_edge(BasicBlock* from, BasicBlock* to, uint8_t flags);
+		static void free_edge(Edge* edge);
+		static Edge* edge_at(uint32_t index);
+		// Detaches the edge from both of its blocks and returns it to the pool.
+		static void remove_edge(Edge* edge);
+		// Sets the flags of one of the block's outgoing edges.
+		void change_flags(Edge& edge, uint8_t flags);
 		class NoSuchEdgeException : public std::logic_error {
 		  public:
 			NoSuchEdgeException() : std::logic_error("No such edge exists between the specified block.") {}
 		};
   	  private:
 		Edge& edge_to(BasicBlock* dest);
+		Edge* find_edge(BasicBlock* dest);
+		void mark_neighbour(BasicBlock* other);
+		void push_outgoing(Edge* edge);
+		void push_incoming(Edge* edge);
+		void remove_outgoing(Edge* edge);
+		void remove_incoming(Edge* edge);
+		void unindex_edge(Edge* edge);
+		void index_edges();
 		
 		std::vector<Edge*> _incoming;
 		std::vector<Edge*> _outgoing;
+		// Maps successors to outgoing edges once the out-degree passes
+		// EDGE_INDEX_THRESHOLD, so edge_to stays O(1) on wide blocks.
+		std::unordered_map<BasicBlock*, Edge*>* _edge_index;
+		// Nonzero if an edge was ever added while one to the same successor
+		// existed; only then must the index be repaired by a scan on removal.
+		uint32_t _parallel_edges;
 		VALUE _name;
 		VALUE _instructions;
-		VALUE _post_order_number;
+		long _phi_count;
 		VALUE _representation;
 		
-		uint8_t _cache_flags;
-		VALUE _cached_successors;
-		VALUE _cached_real_successors;
-		VALUE _cached_predecessors;
-		VALUE _cached_real_predecessors;
+		static inline int view_slot(bool outgoing, edge_filter filter) {
+			return outgoing ? filter : NUM_EDGE_FILTERS + filter;
+		}
+		unsigned long _generation;
+		unsigned long _view_generations[2 * NUM_EDGE_FILTERS];
+		VALUE _views[2 * NUM_EDGE_FILTERS];
+
+		friend class ControlFlowGraph;
+		ControlFlowGraph* _graph;
+		uint32_t _id;
+		uint32_t _preorder;
+		uint32_t _post_order;
+		BasicBlock* _dfs_parent;
+
+		friend class DominatorSnapshot;
+		friend class IncrementalDominators;
+		friend void compute_dominance_frontier(BasicBlock* root);
+		friend void iterated_dominance_frontier(BasicBlock* root, std::vector<BasicBlock*>& set,
+		                                        std::vector<BasicBlock*>& result);
+		BasicBlock* _idom;
+		std::vector<BasicBlock*> _dominated;
+		BasicBlock* _dom_root;
+		unsigned long _dom_generation;
+		uint32_t _dom_post_order;
+		uint32_t _dom_tree_pre;
+		uint32_t _dom_tree_post;
+		// On the root of a dominator tree: the reached blocks, indexed by
+		// post-order number, which doubles as the bit index in frontiers.
+		// Blocks inserted since are appended, and removed ones stay.
+		std::vector<BasicBlock*> _dom_order;
+		// On the root: whether the tree numbers above match its shape.
+		bool _dom_numbered;
+		unsigned long _frontier_generation;
+		Bitset _frontier;
 	};
 }
+extern VALUE rb_mControlFlow;
+extern VALUE rb_cBasicBlock;
 extern "C" {
-	static void bb_mark(void*);
+	extern const rb_data_type_t basic_block_type;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef LASER_BITSET_H_
+#define LASER_BITSET_H_
+
+#include <vector>
+#include <stdint.h>
+
+namespace Laser {
+	// A fixed-size set of small integers, stored as 64-bit words so set
+	// operations work a word at a time.
+	class Bitset {
+	  public:
+		Bitset() : _size(0) {}
+		explicit Bitset(size_t size) : _size(size), _words((size + 63) / 64, 0) {}
+
+		inline size_t size() { return _size; }
+		inline void resize(size_t size) {
+			_size = size;
+			_words.assign((size + 63) / 64, 0);
+		}
+		// Grows the set to hold size bits, keeping its members.
+		inline void grow(size_t size) {
+			if (size > _size) {
+				_size = size;
+				_words.resize((size + 63) / 64, 0);
+			}
+		}
+		inline void clear() { _words.assign(_words.size(), 0); }
+		inline bool test(size_t bit) { return (_words[bit >> 6] >> (bit & 63)) & 1; }
+		inline void set(size_t bit) { _words[bit >> 6] |= (uint64_t)1 << (bit & 63); }
+		inline void reset(size_t bit) { _words[bit >> 6] &= ~((uint64_t)1 << (bit & 63)); }
+		// Sets the bit, returning true if it was not already set.
+		inline bool add(size_t bit) {
+			uint64_t mask = (uint64_t)1 << (bit & 63);
+			uint64_t& word = _words[bit >> 6];
+			if (word & mask) {
+				return false;
+			}
+			word |= mask;
+			return true;
+		}
+		inline bool empty() {
+			for (size_t i = 0; i < _words.size(); ++i) {
+				if (_words[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+		size_t count() {
+			size_t result = 0;
+			for (size_t i = 0; i < _words.size(); ++i) {
+				result += __builtin_popcountll(_words[i]);
+			}
+			return result;
+		}
+		// Unions other into this set, returning true if this set changed.
+		bool union_with(Bitset& other) {
+			bool changed = false;
+			for (size_t i = 0; i < _words.size(); ++i) {
+				uint64_t merged = _words[i] | other._words[i];
+				changed |= (merged != _words[i]);
+				_words[i] = merged;
+			}
+			return changed;
+		}
+		void intersect_with(Bitset& other) {
+			for (size_t i = 0; i < _words.size(); ++i) {
+				_words[i] &= other._words[i];
+			}
+		}
+		void subtract(Bitset& other) {
+			for (size_t i = 0; i < _words.size(); ++i) {
+				_words[i] &= ~other._words[i];
+			}
+		}
+		inline size_t memsize() const { return _words.capacity() * sizeof(uint64_t); }
+		inline bool operator==(const Bitset& other) const { return _words == other._words; }
+		inline bool operator!=(const Bitset& other) const { return _words != other._words; }
+		// Returns the lowest set bit at or after start, or size() if none.
+		size_t next(size_t start) {
+			if (start >= _size) {
+				return _size;
+			}
+			size_t i = start >> 6;
+			uint64_t word = _words[i] & (~(uint64_t)0 << (start & 63));
+			while (true) {
+				if (word) {
+					size_t result = (i << 6) + __builtin_ctzll(word);
+					return result < _size ? result : _size;
+				}
+				if (++i >= _words.size()) {
+					return _size;
+				}
+				word = _words[i];
+			}
+		}
+
+	  private:
+		size_t _size;
+		std::vector<uint64_t> _words;
+	};
+}
+
+#endif
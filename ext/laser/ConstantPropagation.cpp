@@ -0,0 +1,251 @@
+#include "ConstantPropagation.h"
+#include "ControlFlowGraph.h"
+#include "Loops.h"
+#include "ruby.h"
+
+VALUE rb_mConstantPropagation;
+VALUE rb_cConstantPropagationDriver;
+
+using namespace Laser;
+
+static ID id_body;
+static ID id_block;
+static VALUE sym_phi;
+static VALUE sym_jump;
+static VALUE sym_raise;
+static VALUE sym_return;
+
+uint8_t& ConstantPropagationDriver::state(BasicBlock* block) {
+	uint32_t id = block->id();
+	if (id >= _block_states.size()) {
+		_block_states.resize(id + 1, 0);
+	}
+	return _block_states[id];
+}
+
+void ConstantPropagationDriver::push_block(BasicBlock* block) {
+	uint8_t& flags = state(block);
+	if (!(flags & QUEUED)) {
+		flags |= QUEUED;
+		ControlFlowGraph* graph = block->graph();
+		QueuedBlock queued = { graph ? graph->loops().priority(block) : LoopForest::NONE, _pushes++, block };
+		_blocks.push(queued);
+	}
+}
+
+void ConstantPropagationDriver::push_instruction(VALUE instruction) {
+	if (_queued_instructions.insert(instruction).second) {
+		_instructions.push_back(instruction);
+	}
+}
+
+bool ConstantPropagationDriver::consider_edge(BasicBlock* from, BasicBlock* to) {
+	if (!from->mark_executable(to)) {
+		return false;
+	}
+	push_block(to);
+	return true;
+}
+
+VALUE ConstantPropagationDriver::pop_instruction() {
+	VALUE instruction = _instructions.front();
+	_instructions.pop_front();
+	_queued_instructions.erase(instruction);
+	return instruction;
+}
+
+BasicBlock* ConstantPropagationDriver::pop_block() {
+	BasicBlock* block = _blocks.top().block;
+	_blocks.pop();
+	state(block) &= ~QUEUED;
+	return block;
+}
+
+bool ConstantPropagationDriver::visit(BasicBlock* block) {
+	uint8_t& flags = state(block);
+	if (flags & VISITED) {
+		return false;
+	}
+	flags |= VISITED;
+	return true;
+}
+
+// The queued instructions are pinned: the dedupe set hashes them by
+// address, and a driver only lives for one propagation run anyway.
+void ConstantPropagationDriver::mark() {
+	for (std::deque<VALUE>::iterator it = _instructions.begin(); it < _instructions.end(); ++it) {
+		rb_gc_mark(*it);
+	}
+}
+
+size_t ConstantPropagationDriver::memsize() {
+	return sizeof(ConstantPropagationDriver) + _blocks.size() * sizeof(QueuedBlock) +
+	       _instructions.size() * sizeof(void*) +
+	       _queued_instructions.bucket_count() * sizeof(void*) +
+	       _queued_instructions.size() * 2 * sizeof(void*) + _block_states.capacity();
+}
+
+extern "C" {
+	static void cp_mark(void* driver) {
+		static_cast<ConstantPropagationDriver*>(driver)->mark();
+	}
+
+	static void cp_free(void* driver) {
+		delete static_cast<ConstantPropagationDriver*>(driver);
+	}
+
+	static size_t cp_memsize(const void* driver) {
+		return ((ConstantPropagationDriver*)driver)->memsize();
+	}
+
+	static const rb_data_type_t cp_driver_type = {
+		"Laser::Analysis::ControlFlow::ConstantPropagation::Driver",
+		{ cp_mark, cp_free, cp_memsize, },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE cp_alloc(VALUE klass) {
+		ConstantPropagationDriver* driver = new ConstantPropagationDriver();
+		return TypedData_Wrap_Struct(klass, &cp_driver_type, driver);
+	}
+
+	static BasicBlock* cp_graph_block(VALUE block) {
+		BasicBlock *basic_block;
+		TypedData_Get_Struct(block, BasicBlock, &basic_block_type, basic_block);
+		if (basic_block->id() == BasicBlock::NO_ID) {
+			rb_raise(rb_eArgError, "The block %" PRIsVALUE " is not in a graph.", basic_block->name());
+		}
+		return basic_block;
+	}
+
+	static VALUE cp_instruction_type(VALUE instruction) {
+		return rb_ary_entry(rb_ivar_get(instruction, id_body), 0);
+	}
+
+	// Evaluates one instruction of the block: unconditional jumps natively,
+	// everything else by yielding to Ruby. Instructions other than phi nodes
+	// are only run once some edge into their block is known executable.
+	// There must be no C++ locals with destructors here, as the yield can
+	// raise straight through this frame.
+	static void cp_evaluate(ConstantPropagationDriver* driver, VALUE instruction, BasicBlock* block) {
+		VALUE type = cp_instruction_type(instruction);
+		if (type != sym_phi) {
+			std::vector<BasicBlock::Edge*>& predecessors = block->predecessors();
+			const EdgeFilter& executed = edge_filters[FILTER_EXECUTED];
+			size_t i = 0;
+			while (i < predecessors.size() && !executed.passes(predecessors[i]->flags)) {
+				++i;
+			}
+			if (i == predecessors.size()) {
+				return;
+			}
+		}
+		if (type == sym_jump || type == sym_raise || type == sym_return) {
+			std::vector<BasicBlock::Edge*>& successors = block->successors();
+			for (size_t i = 0; i < successors.size(); ++i) {
+				if (!(successors[i]->flags & EDGE_FAKE)) {
+					driver->consider_edge(block, successors[i]->to);
+					break;
+				}
+			}
+			return;
+		}
+		rb_yield(instruction);
+	}
+
+	// Phi nodes execute upon every entry to the block, as their operands
+	// may have changed; the rest only on the first. Blocks without
+	// instructions fall through to all their successors.
+	// Morgan, p.200
+	static void cp_simulate_block(ConstantPropagationDriver* driver, BasicBlock* block) {
+		VALUE instructions = block->instructions();
+		for (long i = 0; i < block->phi_count(); ++i) {
+			cp_evaluate(driver, rb_ary_entry(instructions, i), block);
+		}
+		if (!driver->visit(block)) {
+			return;
+		}
+		for (long i = block->phi_count(); i < RARRAY_LEN(instructions); ++i) {
+			cp_evaluate(driver, rb_ary_entry(instructions, i), block);
+		}
+		if (RARRAY_LEN(instructions) == 0) {
+			std::vector<BasicBlock::Edge*>& successors = block->successors();
+			for (size_t i = 0; i < successors.size(); ++i) {
+				driver->consider_edge(block, successors[i]->to);
+			}
+		}
+	}
+
+	static VALUE cp_push_block(VALUE self, VALUE block) {
+		ConstantPropagationDriver *driver;
+		TypedData_Get_Struct(self, ConstantPropagationDriver, &cp_driver_type, driver);
+		driver->push_block(cp_graph_block(block));
+		return self;
+	}
+
+	static VALUE cp_push_instruction(VALUE self, VALUE instruction) {
+		ConstantPropagationDriver *driver;
+		TypedData_Get_Struct(self, ConstantPropagationDriver, &cp_driver_type, driver);
+		driver->push_instruction(instruction);
+		return self;
+	}
+
+	static VALUE cp_consider_edge(VALUE self, VALUE from, VALUE to) {
+		ConstantPropagationDriver *driver;
+		TypedData_Get_Struct(self, ConstantPropagationDriver, &cp_driver_type, driver);
+		BasicBlock *from_block = cp_graph_block(from);
+		BasicBlock *to_block = cp_graph_block(to);
+		bool queued = false, missing = false;
+		try {
+			queued = driver->consider_edge(from_block, to_block);
+		} catch (const BasicBlock::NoSuchEdgeException&) {
+			// Raised outside the handler, so the exception is released first.
+			missing = true;
+		}
+		if (missing) {
+			rb_raise(rb_eArgError, "The given edge does not exist.");
+		}
+		return queued ? Qtrue : Qfalse;
+	}
+
+	// Runs until both worklists are empty, draining the instruction worklist
+	// before simulating each block. Yields each instruction to evaluate;
+	// the block queues whatever the evaluation makes newly reachable.
+	static VALUE cp_run(VALUE self) {
+		ConstantPropagationDriver *driver;
+		TypedData_Get_Struct(self, ConstantPropagationDriver, &cp_driver_type, driver);
+		rb_need_block();
+		while (true) {
+			if (driver->has_instructions()) {
+				VALUE instruction = driver->pop_instruction();
+				VALUE block = rb_ivar_get(instruction, id_block);
+				if (NIL_P(block)) {
+					rb_raise(rb_eArgError, "Queued an instruction that is not in a block.");
+				}
+				cp_evaluate(driver, instruction, cp_graph_block(block));
+			} else if (driver->has_blocks()) {
+				cp_simulate_block(driver, driver->pop_block());
+			} else {
+				break;
+			}
+		}
+		return self;
+	}
+
+	void Init_ConstantPropagation() {
+		id_body = rb_intern("@body");
+		id_block = rb_intern("@block");
+		sym_phi = ID2SYM(rb_intern("phi"));
+		sym_jump = ID2SYM(rb_intern("jump"));
+		sym_raise = ID2SYM(rb_intern("raise"));
+		sym_return = ID2SYM(rb_intern("return"));
+
+		rb_mConstantPropagation = rb_define_module_under(rb_mControlFlow, "ConstantPropagation");
+		rb_cConstantPropagationDriver = rb_define_class_under(rb_mConstantPropagation, "Driver", rb_cObject);
+		rb_define_alloc_func(rb_cConstantPropagationDriver, cp_alloc);
+		rb_define_method(rb_cConstantPropagationDriver, "push_block", RUBY_METHOD_FUNC(cp_push_block), 1);
+		rb_define_method(rb_cConstantPropagationDriver, "push_instruction", RUBY_METHOD_FUNC(cp_push_instruction), 1);
+		rb_define_method(rb_cConstantPropagationDriver, "consider_edge", RUBY_METHOD_FUNC(cp_consider_edge), 2);
+		rb_define_method(rb_cConstantPropagationDriver, "run", RUBY_METHOD_FUNC(cp_run), 0);
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef LASER_CONSTANT_PROPAGATION_H_
+#define LASER_CONSTANT_PROPAGATION_H_
+
+#include <deque>
+#include <queue>
+#include <vector>
+#include <unordered_set>
+#include "BasicBlock.h"
+#include "ruby.h"
+
+namespace Laser {
+	// The worklist driver for Wegman and Zadeck's sparse conditional constant
+	// propagation, following Morgan p.200. Blocks are queued when an edge
+	// into them is first flagged executable, and instructions when the value
+	// of a temp they use changes. Neither worklist holds an entry twice.
+	// Instructions are FIFO; blocks come out in the graph's loop-aware order
+	// (see LoopForest), so a loop's body settles before what follows it.
+	//
+	// The lattice values themselves live on the temps, since evaluating an
+	// instruction reads them from Ruby; the driver only hands back the
+	// instructions that need evaluating.
+	class ConstantPropagationDriver {
+	  public:
+		ConstantPropagationDriver() : _pushes(0) {}
+
+		// Queues the block unless it is already queued.
+		void push_block(BasicBlock* block);
+		// Queues the instruction unless it is already queued, by identity.
+		void push_instruction(VALUE instruction);
+		// Flags the edge executable and queues its destination, unless the
+		// edge is fake or was already executable. Returns true if queued.
+		bool consider_edge(BasicBlock* from, BasicBlock* to);
+
+		inline bool has_instructions() { return !_instructions.empty(); }
+		inline bool has_blocks() { return !_blocks.empty(); }
+		VALUE pop_instruction();
+		BasicBlock* pop_block();
+		// Returns true the first time it is called with the block.
+		bool visit(BasicBlock* block);
+
+		void mark();
+		size_t memsize();
+
+	  private:
+		enum {QUEUED = 1, VISITED = 2};
+		uint8_t& state(BasicBlock* block);
+
+		// A queued block, by its place in the loop-aware order and then by
+		// when it was pushed, for blocks outside the order.
+		struct QueuedBlock {
+			uint32_t priority;
+			uint64_t push;
+			BasicBlock* block;
+			inline bool operator>(const QueuedBlock& other) const {
+				return priority != other.priority ? priority > other.priority : push > other.push;
+			}
+		};
+
+		std::priority_queue<QueuedBlock, std::vector<QueuedBlock>, std::greater<QueuedBlock> > _blocks;
+		uint64_t _pushes;
+		std::deque<VALUE> _instructions;
+		std::unordered_set<VALUE> _queued_instructions;
+		// Per block ID.
+		std::vector<uint8_t> _block_states;
+	};
+}
+extern "C" {
+	void Init_ConstantPropagation();
+}
+
+#endif
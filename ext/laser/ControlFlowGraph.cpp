@@ -0,0 +1,825 @@
+#include "ControlFlowGraph.h"
+#include "Overlay.h"
+#include "Loops.h"
+#include <algorithm>
+#include "ruby.h"
+
+VALUE rb_mRGL;
+VALUE rb_cControlFlowGraph;
+
+using namespace Laser;
+
+static std::string name_key(VALUE name) {
+	return std::string(RSTRING_PTR(name), RSTRING_LEN(name));
+}
+
+void ControlFlowGraph::add_vertex(BasicBlock* block) {
+	if (has_vertex(block)) {
+		return;
+	}
+	if (block->_graph == NULL) {
+		block->_graph = this;
+		_owned.push_back(block);
+		retain();
+	}
+	if (_free_ids.empty()) {
+		block->_id = _blocks.size();
+		_blocks.push_back(block);
+	} else {
+		block->_id = _free_ids.back();
+		_free_ids.pop_back();
+		_blocks[block->_id] = block;
+	}
+	++_num_vertices;
+	if (_entry == NULL) {
+		_entry = block;
+		invalidate_dominators();
+	}
+	if (RB_TYPE_P(block->name(), T_STRING)) {
+		_names[name_key(block->name())] = block;
+	}
+	invalidate_traversal();
+}
+
+void ControlFlowGraph::add_vertex_at(BasicBlock* block, uint32_t id) {
+	if (id >= _blocks.size()) {
+		for (uint32_t free_id = _blocks.size(); free_id < id; ++free_id) {
+			_free_ids.push_back(free_id);
+		}
+		_blocks.resize(id + 1, NULL);
+	} else {
+		_free_ids.erase(std::find(_free_ids.begin(), _free_ids.end(), id));
+	}
+	if (block->_graph == NULL) {
+		block->_graph = this;
+		_owned.push_back(block);
+		retain();
+	}
+	block->_id = id;
+	_blocks[id] = block;
+	++_num_vertices;
+	if (_entry == NULL) {
+		_entry = block;
+		invalidate_dominators();
+	}
+	if (RB_TYPE_P(block->name(), T_STRING)) {
+		_names[name_key(block->name())] = block;
+	}
+	invalidate_traversal();
+}
+
+void ControlFlowGraph::remove_vertex(BasicBlock* block) {
+	if (!has_vertex(block)) {
+		return;
+	}
+	block->clear_edges();
+	unregister_name(block);
+	_blocks[block->_id] = NULL;
+	_free_ids.push_back(block->_id);
+	block->_id = BasicBlock::NO_ID;
+	block->_preorder = block->_post_order = BasicBlock::NO_ID;
+	block->_dfs_parent = NULL;
+	if (block == _entry) {
+		_entry = NULL;
+		invalidate_dominators();
+	}
+	--_num_vertices;
+	invalidate_traversal();
+}
+
+void ControlFlowGraph::unregister_name(BasicBlock* block) {
+	if (!RB_TYPE_P(block->name(), T_STRING)) {
+		return;
+	}
+	std::unordered_map<std::string, BasicBlock*>::iterator it = _names.find(name_key(block->name()));
+	if (it != _names.end() && it->second == block) {
+		_names.erase(it);
+	}
+}
+
+BasicBlock* ControlFlowGraph::vertex_with_name(VALUE name) {
+	if (!RB_TYPE_P(name, T_STRING)) {
+		return NULL;
+	}
+	std::unordered_map<std::string, BasicBlock*>::iterator it = _names.find(name_key(name));
+	return (it == _names.end()) ? NULL : it->second;
+}
+
+size_t ControlFlowGraph::num_edges() {
+	size_t result = 0;
+	for (std::vector<BasicBlock*>::iterator it = _blocks.begin(); it < _blocks.end(); ++it) {
+		if (*it) {
+			result += (*it)->successors().size();
+		}
+	}
+	return result;
+}
+
+void ControlFlowGraph::copy_edges(ControlFlowGraph& source) {
+	using namespace std;
+	for (size_t id = 0; id < source.id_limit(); ++id) {
+		BasicBlock *original = source.vertex(id);
+		if (original) {
+			BasicBlock *copy = _blocks[id];
+			copy->_outgoing.resize(original->_outgoing.size());
+			copy->_incoming.resize(original->_incoming.size());
+			copy->_parallel_edges = original->_parallel_edges;
+			copy->clear_cache();
+		}
+	}
+	for (size_t id = 0; id < source.id_limit(); ++id) {
+		BasicBlock *original = source.vertex(id);
+		if (!original) {
+			continue;
+		}
+		vector<BasicBlock::Edge*>& outgoing = original->_outgoing;
+		for (vector<BasicBlock::Edge*>::iterator it = outgoing.begin(); it < outgoing.end(); ++it) {
+			BasicBlock::Edge *edge = BasicBlock::allocate_edge(
+			    _blocks[id], _blocks[(*it)->to->_id], (*it)->flags);
+			edge->out_pos = (*it)->out_pos;
+			edge->in_pos = (*it)->in_pos;
+			edge->from->_outgoing[edge->out_pos] = edge;
+			edge->to->_incoming[edge->in_pos] = edge;
+		}
+		// Parallel edges make the index's choice of edge matter, so an
+		// existing index is mirrored rather than rebuilt.
+		if (original->_edge_index) {
+			BasicBlock *copy = _blocks[id];
+			copy->_edge_index = new unordered_map<BasicBlock*, BasicBlock::Edge*>;
+			for (unordered_map<BasicBlock*, BasicBlock::Edge*>::iterator entry = original->_edge_index->begin();
+			     entry != original->_edge_index->end(); ++entry) {
+				copy->_edge_index->insert(make_pair(_blocks[entry->first->_id],
+				                                    copy->_outgoing[entry->second->out_pos]));
+			}
+		}
+	}
+}
+
+void ControlFlowGraph::compute_traversal() {
+	using namespace std;
+	if (_traversal_valid) {
+		return;
+	}
+	_post_order.clear();
+	for (vector<BasicBlock*>::iterator it = _blocks.begin(); it < _blocks.end(); ++it) {
+		if (*it) {
+			(*it)->_preorder = (*it)->_post_order = BasicBlock::NO_ID;
+			(*it)->_dfs_parent = NULL;
+		}
+	}
+	_traversal_valid = true;
+	if (_entry == NULL) {
+		return;
+	}
+	uint32_t preorder = 0;
+	vector<pair<BasicBlock*, size_t> > stack;
+	_entry->_preorder = preorder++;
+	stack.push_back(make_pair(_entry, 0));
+	while (!stack.empty()) {
+		BasicBlock* block = stack.back().first;
+		size_t& next = stack.back().second;
+		vector<BasicBlock::Edge*>& succs = block->successors();
+		bool descended = false;
+		while (next < succs.size()) {
+			BasicBlock::Edge* edge = succs[next++];
+			BasicBlock* succ = edge->to;
+			if ((edge->flags & EDGE_FAKE) == 0 && succ->_preorder == BasicBlock::NO_ID) {
+				succ->_preorder = preorder++;
+				succ->_dfs_parent = block;
+				stack.push_back(make_pair(succ, 0));
+				descended = true;
+				break;
+			}
+		}
+		if (!descended) {
+			block->_post_order = _post_order.size();
+			_post_order.push_back(block);
+			stack.pop_back();
+		}
+	}
+}
+
+void ControlFlowGraph::reachable_set(Bitset& result) {
+	compute_traversal();
+	result.resize(_blocks.size());
+	for (std::vector<BasicBlock*>::iterator it = _post_order.begin(); it < _post_order.end(); ++it) {
+		result.set((*it)->_id);
+	}
+}
+
+void ControlFlowGraph::unexecuted_edges(std::vector<BasicBlock::Edge*>& result) {
+	using namespace std;
+	for (vector<BasicBlock*>::iterator it = _blocks.begin(); it < _blocks.end(); ++it) {
+		if (!*it) {
+			continue;
+		}
+		vector<BasicBlock::Edge*>& outgoing = (*it)->successors();
+		for (vector<BasicBlock::Edge*>::iterator edge = outgoing.begin(); edge < outgoing.end(); ++edge) {
+			if (((*edge)->flags & (EDGE_EXECUTABLE | EDGE_FAKE)) == 0) {
+				result.push_back(*edge);
+			}
+		}
+	}
+}
+
+VALUE ControlFlowGraph::post_order_array() {
+	compute_traversal();
+	if (NIL_P(_post_order_array)) {
+		++native_counters.arrays_allocated;
+		_post_order_array = rb_ary_new2(_post_order.size());
+		for (std::vector<BasicBlock*>::iterator it = _post_order.begin(); it < _post_order.end(); ++it) {
+			rb_ary_push(_post_order_array, (*it)->representation());
+		}
+		rb_obj_freeze(_post_order_array);
+	}
+	return _post_order_array;
+}
+
+VALUE ControlFlowGraph::reverse_post_order_array() {
+	compute_traversal();
+	if (NIL_P(_reverse_post_order_array)) {
+		++native_counters.arrays_allocated;
+		_reverse_post_order_array = rb_ary_new2(_post_order.size());
+		for (std::vector<BasicBlock*>::reverse_iterator it = _post_order.rbegin(); it < _post_order.rend(); ++it) {
+			rb_ary_push(_reverse_post_order_array, (*it)->representation());
+		}
+		rb_obj_freeze(_reverse_post_order_array);
+	}
+	return _reverse_post_order_array;
+}
+
+void ControlFlowGraph::edge_removed(BasicBlock::Edge* edge) {
+	++_edge_removals;
+	if (_overlay) {
+		_overlay->forget(edge);
+	}
+}
+
+void ControlFlowGraph::release() {
+	if (--_refs == 0) {
+		delete this;
+	}
+}
+
+// Every block still owned is either unreachable from Ruby or being freed
+// alongside the graph, so edges between owned blocks can simply be freed.
+// Edges to and from blocks outside the graph are unlinked from those
+// blocks first; incoming edges are handled before any edge is freed.
+ControlFlowGraph::~ControlFlowGraph() {
+	using namespace std;
+	for (vector<BasicBlock*>::iterator it = _owned.begin(); it < _owned.end(); ++it) {
+		vector<BasicBlock::Edge*>& incoming = (*it)->predecessors();
+		for (vector<BasicBlock::Edge*>::iterator edge = incoming.begin(); edge < incoming.end(); ++edge) {
+			BasicBlock* from = (*edge)->from;
+			if (from->_graph != this) {
+				from->remove_outgoing(*edge);
+				from->clear_cache();
+				BasicBlock::free_edge(*edge);
+			}
+		}
+		incoming.clear();
+	}
+	for (vector<BasicBlock*>::iterator it = _owned.begin(); it < _owned.end(); ++it) {
+		vector<BasicBlock::Edge*>& outgoing = (*it)->successors();
+		for (vector<BasicBlock::Edge*>::iterator edge = outgoing.begin(); edge < outgoing.end(); ++edge) {
+			BasicBlock* to = (*edge)->to;
+			if (to->_graph != this) {
+				to->remove_incoming(*edge);
+				to->clear_cache();
+			}
+			BasicBlock::free_edge(*edge);
+		}
+		delete *it;
+	}
+	delete _loops;
+}
+
+LoopForest& ControlFlowGraph::loops() {
+	if (!_loops) {
+		_loops = new LoopForest(this);
+	}
+	return *_loops;
+}
+
+void ControlFlowGraph::mark() {
+	for (std::vector<BasicBlock*>::iterator it = _blocks.begin(); it < _blocks.end(); ++it) {
+		if (*it) {
+			rb_gc_mark_movable((*it)->representation());
+		}
+	}
+	rb_gc_mark_movable(_post_order_array);
+	rb_gc_mark_movable(_reverse_post_order_array);
+	if (_overlay) {
+		rb_gc_mark_movable(_overlay->representation());
+	}
+}
+
+void ControlFlowGraph::compact() {
+	_representation = rb_gc_location(_representation);
+	_post_order_array = rb_gc_location(_post_order_array);
+	_reverse_post_order_array = rb_gc_location(_reverse_post_order_array);
+}
+
+size_t ControlFlowGraph::memsize() {
+	size_t size = sizeof(ControlFlowGraph);
+	size += (_blocks.capacity() + _owned.capacity() + _post_order.capacity()) * sizeof(BasicBlock*);
+	size += _free_ids.capacity() * sizeof(uint32_t);
+	size += _names.bucket_count() * sizeof(void*);
+	for (std::unordered_map<std::string, BasicBlock*>::iterator it = _names.begin(); it != _names.end(); ++it) {
+		size += sizeof(*it) + sizeof(void*) + it->first.capacity();
+	}
+	if (_loops) {
+		size += _loops->memsize();
+	}
+	return size;
+}
+
+extern "C" {
+	static void cfg_mark(void* p) {
+		ControlFlowGraph *graph = (ControlFlowGraph*)p;
+		graph->mark();
+	}
+
+	static void cfg_free(void* p) {
+		ControlFlowGraph *graph = (ControlFlowGraph*)p;
+		graph->release();
+	}
+
+	static size_t cfg_memsize(const void* p) {
+		return ((ControlFlowGraph*)p)->memsize();
+	}
+
+	static void cfg_compact(void* p) {
+		((ControlFlowGraph*)p)->compact();
+	}
+
+	const rb_data_type_t control_flow_graph_type = {
+		"Laser::Analysis::ControlFlow::ControlFlowGraph",
+		{ cfg_mark, cfg_free, cfg_memsize, LASER_DCOMPACT(cfg_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE cfg_alloc(VALUE klass) {
+		ControlFlowGraph *graph = new ControlFlowGraph;
+		VALUE result = TypedData_Wrap_Struct(klass, &control_flow_graph_type, graph);
+		graph->set_representation(result);
+		return result;
+	}
+
+	static BasicBlock* cfg_block_in(ControlFlowGraph* graph, VALUE block_value) {
+		BasicBlock *block;
+		TypedData_Get_Struct(block_value, BasicBlock, &basic_block_type, block);
+		if (!graph->has_vertex(block)) {
+			rb_raise(rb_eArgError, "The block %" PRIsVALUE " is not in this graph.", block->name());
+		}
+		return block;
+	}
+
+	static VALUE cfg_add_vertex(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		BasicBlock *block;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		TypedData_Get_Struct(block_value, BasicBlock, &basic_block_type, block);
+		if (block->graph() && block->graph() != graph) {
+			rb_raise(rb_eArgError, "The block %" PRIsVALUE " belongs to another graph.", block->name());
+		}
+		graph->add_vertex(block);
+		return block_value;
+	}
+
+	static VALUE cfg_remove_vertex(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		BasicBlock *block;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		TypedData_Get_Struct(block_value, BasicBlock, &basic_block_type, block);
+		graph->remove_vertex(block);
+		return Qnil;
+	}
+
+	static VALUE cfg_add_edge(int argc, VALUE* argv, VALUE self) {
+		ControlFlowGraph *graph;
+		VALUE from, to, flags;
+		rb_scan_args(argc, argv, "21", &from, &to, &flags);
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		BasicBlock *from_block = cfg_block_in(graph, from);
+		BasicBlock *to_block = cfg_block_in(graph, to);
+		from_block->join(to_block, NIL_P(flags) ? EDGE_NORMAL : FIX2INT(flags));
+		return Qnil;
+	}
+
+	static uint8_t cfg_edge_flags(VALUE flags) {
+		if (NIL_P(flags)) {
+			return EDGE_NORMAL;
+		}
+		int value = NUM2INT(flags);
+		if (value < 0 || value > 0xff) {
+			rb_raise(rb_eArgError, "Edge flags must be in 0..255, not %d.", value);
+		}
+		return (uint8_t)value;
+	}
+
+	// Adds many edges at once from a flat Array of from, to, flags triples
+	// (nil flags mean EDGE_NORMAL). Every triple is checked before any edge
+	// is added; adjacency lists are grown once and each touched block's
+	// caches are cleared once. Checking can raise, so it fills buffers the
+	// GC owns, and nothing with a destructor is built until it is done.
+	static VALUE cfg_add_edges(VALUE self, VALUE triples) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		Check_Type(triples, T_ARRAY);
+		long length = RARRAY_LEN(triples);
+		if (length % 3 != 0) {
+			rb_raise(rb_eArgError, "Edges must be given as from, to, flags triples.");
+		}
+		long count = length / 3;
+		VALUE ends_buffer, flags_buffer;
+		BasicBlock** ends = ALLOCV_N(BasicBlock*, ends_buffer, 2 * count);
+		uint8_t* flags = ALLOCV_N(uint8_t, flags_buffer, count);
+		for (long i = 0; i < count; ++i) {
+			ends[2 * i] = cfg_block_in(graph, rb_ary_entry(triples, 3 * i));
+			ends[2 * i + 1] = cfg_block_in(graph, rb_ary_entry(triples, 3 * i + 1));
+			flags[i] = cfg_edge_flags(rb_ary_entry(triples, 3 * i + 2));
+		}
+		{
+			std::vector<uint32_t> out_degree(graph->id_limit(), 0), in_degree(graph->id_limit(), 0);
+			for (long i = 0; i < count; ++i) {
+				++out_degree[ends[2 * i]->id()];
+				++in_degree[ends[2 * i + 1]->id()];
+			}
+			for (size_t id = 0; id < graph->id_limit(); ++id) {
+				if (out_degree[id] || in_degree[id]) {
+					graph->vertex(id)->reserve_edges(out_degree[id], in_degree[id]);
+				}
+			}
+			for (long i = 0; i < count; ++i) {
+				ends[2 * i]->connect(ends[2 * i + 1], flags[i]);
+			}
+			for (size_t id = 0; id < graph->id_limit(); ++id) {
+				if (out_degree[id] || in_degree[id]) {
+					graph->vertex(id)->clear_cache();
+				}
+			}
+		}
+		ALLOCV_END(ends_buffer);
+		ALLOCV_END(flags_buffer);
+		return self;
+	}
+
+	// Goes through BasicBlock#disconnect so that its branch and phi node
+	// fix-ups are applied.
+	static VALUE cfg_remove_edge(VALUE self, VALUE from, VALUE to) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		BasicBlock *from_block = cfg_block_in(graph, from);
+		BasicBlock *to_block = cfg_block_in(graph, to);
+		return rb_funcall(from_block->representation(), rb_intern("disconnect"), 1,
+		                  to_block->representation());
+	}
+
+	// Copies source's blocks and edges into this graph, which must be fresh:
+	// blocks it already holds (Enter and Exit) stand in for the source blocks
+	// with the same ID and name. Each other block is copied with its name and
+	// class but no instructions. Returns an Array mapping each source block
+	// ID to its copy, which has the same ID.
+	static VALUE cfg_copy_topology(VALUE self, VALUE source_value) {
+		ControlFlowGraph *graph, *source;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		TypedData_Get_Struct(source_value, ControlFlowGraph, &control_flow_graph_type, source);
+		if (graph->num_edges() != 0 || graph->num_vertices() > source->num_vertices()) {
+			rb_raise(rb_eArgError, "Topology can only be copied into a fresh graph.");
+		}
+		for (size_t id = 0; id < graph->id_limit(); ++id) {
+			BasicBlock *existing = graph->vertex(id);
+			if (existing && (id >= source->id_limit() || !source->vertex(id) ||
+			                 rb_str_equal(existing->name(), source->vertex(id)->name()) != Qtrue)) {
+				rb_raise(rb_eArgError, "The block %" PRIsVALUE " has no counterpart in the source graph.",
+				         existing->name());
+			}
+		}
+		VALUE result = rb_ary_new2(source->id_limit());
+		for (size_t id = 0; id < source->id_limit(); ++id) {
+			BasicBlock *original = source->vertex(id);
+			if (!original) {
+				rb_ary_push(result, Qnil);
+				continue;
+			}
+			if (id < graph->id_limit() && graph->vertex(id)) {
+				rb_ary_push(result, graph->vertex(id)->representation());
+				continue;
+			}
+			VALUE copy_value = rb_obj_alloc(rb_obj_class(original->representation()));
+			BasicBlock *copy;
+			TypedData_Get_Struct(copy_value, BasicBlock, &basic_block_type, copy);
+			copy->set_name(original->name());
+			graph->add_vertex_at(copy, id);
+			rb_ary_push(result, copy_value);
+		}
+		graph->copy_edges(*source);
+		return result;
+	}
+
+	static VALUE cfg_post_order(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return graph->post_order_array();
+	}
+
+	static VALUE cfg_reverse_post_order(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return graph->reverse_post_order_array();
+	}
+
+	static VALUE cfg_each_reverse_post_order(VALUE self) {
+		RETURN_ENUMERATOR(self, 0, 0);
+		return rb_ary_each(cfg_reverse_post_order(self));
+	}
+
+	static VALUE cfg_reachable(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		BasicBlock *block;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		TypedData_Get_Struct(block_value, BasicBlock, &basic_block_type, block);
+		return graph->reachable(block) ? Qtrue : Qfalse;
+	}
+
+	static VALUE cfg_unreachable_vertices(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		Bitset reachable;
+		graph->reachable_set(reachable);
+		VALUE result = rb_ary_new();
+		for (size_t id = 0; id < graph->id_limit(); ++id) {
+			if (graph->vertex(id) && !reachable.test(id)) {
+				rb_ary_push(result, graph->vertex(id)->representation());
+			}
+		}
+		return result;
+	}
+
+	// Marks every edge that is neither executable nor fake as fake, so that
+	// the postdominance of Exit is preserved but dead code analysis ignores
+	// it. With a true argument the edges are removed instead, through
+	// BasicBlock#disconnect so that its branch and phi fix-ups still apply.
+	// Returns the number of edges killed.
+	static VALUE cfg_kill_unexecuted_edges(int argc, VALUE* argv, VALUE self) {
+		ControlFlowGraph *graph;
+		VALUE remove;
+		rb_scan_args(argc, argv, "01", &remove);
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		if (!RTEST(remove)) {
+			std::vector<BasicBlock::Edge*> killable;
+			graph->unexecuted_edges(killable);
+			for (std::vector<BasicBlock::Edge*>::iterator it = killable.begin(); it < killable.end(); ++it) {
+				(*it)->from->change_flags(**it, (*it)->flags | EDGE_FAKE);
+			}
+			return ULONG2NUM(killable.size());
+		}
+		// disconnect's fix-ups run Ruby code that may raise, so the edges are
+		// copied out and the vector is gone before any of it runs.
+		VALUE pairs;
+		{
+			std::vector<BasicBlock::Edge*> killable;
+			graph->unexecuted_edges(killable);
+			pairs = rb_ary_new2(killable.size() * 2);
+			for (std::vector<BasicBlock::Edge*>::iterator it = killable.begin(); it < killable.end(); ++it) {
+				rb_ary_push(pairs, (*it)->from->representation());
+				rb_ary_push(pairs, (*it)->to->representation());
+			}
+		}
+		ID disconnect = rb_intern("disconnect");
+		for (long i = 0; i < RARRAY_LEN(pairs); i += 2) {
+			rb_funcall(rb_ary_entry(pairs, i), disconnect, 1, rb_ary_entry(pairs, i + 1));
+		}
+		return LONG2NUM(RARRAY_LEN(pairs) / 2);
+	}
+
+	static VALUE cfg_entered_overlay(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return graph->overlay() ? graph->overlay()->representation() : Qnil;
+	}
+
+	// The block's traversal, computed if need be, or NULL if the block is
+	// in no graph.
+	static BasicBlock* bb_traversed(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		if (!block->graph() || !block->graph()->has_vertex(block)) {
+			return NULL;
+		}
+		block->graph()->compute_traversal();
+		return block;
+	}
+
+	static VALUE bb_post_order_number(VALUE self) {
+		BasicBlock *block = bb_traversed(self);
+		if (!block || block->post_order_number() == BasicBlock::NO_ID) {
+			return Qnil;
+		}
+		return UINT2NUM(block->post_order_number());
+	}
+
+	static VALUE bb_reverse_post_order_number(VALUE self) {
+		BasicBlock *block = bb_traversed(self);
+		if (!block || block->post_order_number() == BasicBlock::NO_ID) {
+			return Qnil;
+		}
+		return UINT2NUM(block->graph()->post_order().size() - 1 - block->post_order_number());
+	}
+
+	static VALUE bb_preorder_number(VALUE self) {
+		BasicBlock *block = bb_traversed(self);
+		if (!block || block->preorder_number() == BasicBlock::NO_ID) {
+			return Qnil;
+		}
+		return UINT2NUM(block->preorder_number());
+	}
+
+	static VALUE bb_dfs_parent(VALUE self) {
+		BasicBlock *block = bb_traversed(self);
+		if (!block || !block->dfs_parent()) {
+			return Qnil;
+		}
+		return block->dfs_parent()->representation();
+	}
+
+	static VALUE cfg_vertex_with_name(VALUE self, VALUE name) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		BasicBlock *block = graph->vertex_with_name(name);
+		return block ? block->representation() : Qnil;
+	}
+
+	static VALUE cfg_lookup(VALUE self, VALUE key) {
+		BasicBlock *block;
+		TypedData_Get_Struct(key, BasicBlock, &basic_block_type, block);
+		return cfg_vertex_with_name(self, block->name());
+	}
+
+	static VALUE cfg_vertex(VALUE self, VALUE id) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		long idx = NUM2LONG(id);
+		if (idx < 0 || (size_t)idx >= graph->id_limit() || !graph->vertex(idx)) {
+			return Qnil;
+		}
+		return graph->vertex(idx)->representation();
+	}
+
+	static VALUE cfg_vertices(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		VALUE result = rb_ary_new2(graph->num_vertices());
+		for (size_t id = 0; id < graph->id_limit(); ++id) {
+			if (graph->vertex(id)) {
+				rb_ary_push(result, graph->vertex(id)->representation());
+			}
+		}
+		return result;
+	}
+
+	static VALUE cfg_each_vertex(VALUE self) {
+		RETURN_ENUMERATOR(self, 0, 0);
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		for (size_t id = 0; id < graph->id_limit(); ++id) {
+			if (graph->vertex(id)) {
+				rb_yield(graph->vertex(id)->representation());
+			}
+		}
+		return self;
+	}
+
+	static VALUE cfg_edges(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		VALUE result = rb_ary_new2(graph->num_edges());
+		for (size_t id = 0; id < graph->id_limit(); ++id) {
+			BasicBlock *block = graph->vertex(id);
+			if (block == NULL) {
+				continue;
+			}
+			std::vector<BasicBlock::Edge*>& list = block->successors();
+			for (std::vector<BasicBlock::Edge*>::iterator it = list.begin(); it < list.end(); ++it) {
+				rb_ary_push(result, rb_assoc_new(block->representation(), (*it)->to->representation()));
+			}
+		}
+		return result;
+	}
+
+	// Yields each edge as (from, to). The edges are snapshotted first, so
+	// the block may add or remove edges as it goes.
+	static VALUE cfg_each_edge(VALUE self) {
+		RETURN_ENUMERATOR(self, 0, 0);
+		VALUE edges = cfg_edges(self);
+		for (long i = 0; i < RARRAY_LEN(edges); ++i) {
+			rb_yield_values2(2, RARRAY_CONST_PTR(rb_ary_entry(edges, i)));
+		}
+		return self;
+	}
+
+	static VALUE cfg_num_vertices(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return SIZET2NUM(graph->num_vertices());
+	}
+
+	static VALUE cfg_num_edges(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return SIZET2NUM(graph->num_edges());
+	}
+
+	static VALUE cfg_id_limit(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return SIZET2NUM(graph->id_limit());
+	}
+
+	static VALUE cfg_empty(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return graph->num_vertices() == 0 ? Qtrue : Qfalse;
+	}
+
+	static VALUE cfg_has_vertex(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		if (!rb_obj_is_kind_of(block_value, rb_cBasicBlock)) {
+			return Qfalse;
+		}
+		BasicBlock *block;
+		TypedData_Get_Struct(block_value, BasicBlock, &basic_block_type, block);
+		return graph->has_vertex(block) ? Qtrue : Qfalse;
+	}
+
+	static VALUE cfg_has_edge(VALUE self, VALUE from, VALUE to) {
+		ControlFlowGraph *graph;
+		BasicBlock *to_block;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		BasicBlock *from_block = cfg_block_in(graph, from);
+		TypedData_Get_Struct(to, BasicBlock, &basic_block_type, to_block);
+		std::vector<BasicBlock::Edge*>& list = from_block->successors();
+		for (std::vector<BasicBlock::Edge*>::iterator it = list.begin(); it < list.end(); ++it) {
+			if ((*it)->to == to_block) {
+				return Qtrue;
+			}
+		}
+		return Qfalse;
+	}
+
+	static VALUE cfg_in_degree(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return SIZET2NUM(cfg_block_in(graph, block_value)->predecessors().size());
+	}
+
+	static VALUE cfg_out_degree(VALUE self, VALUE block_value) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		return SIZET2NUM(cfg_block_in(graph, block_value)->successors().size());
+	}
+
+	void Init_ControlFlowGraph() {
+		rb_mRGL = rb_define_module("RGL");
+		rb_cControlFlowGraph = rb_define_class_under(rb_mRGL, "ControlFlowGraph", rb_cObject);
+		rb_define_alloc_func(rb_cControlFlowGraph, cfg_alloc);
+		rb_define_method(rb_cControlFlowGraph, "add_vertex", RUBY_METHOD_FUNC(cfg_add_vertex), 1);
+		rb_define_method(rb_cControlFlowGraph, "remove_vertex", RUBY_METHOD_FUNC(cfg_remove_vertex), 1);
+		rb_define_method(rb_cControlFlowGraph, "add_edge", RUBY_METHOD_FUNC(cfg_add_edge), -1);
+		rb_define_method(rb_cControlFlowGraph, "add_edges", RUBY_METHOD_FUNC(cfg_add_edges), 1);
+		rb_define_method(rb_cControlFlowGraph, "remove_edge", RUBY_METHOD_FUNC(cfg_remove_edge), 2);
+		rb_define_method(rb_cControlFlowGraph, "copy_topology", RUBY_METHOD_FUNC(cfg_copy_topology), 1);
+		rb_define_method(rb_cControlFlowGraph, "vertex_with_name", RUBY_METHOD_FUNC(cfg_vertex_with_name), 1);
+		rb_define_method(rb_cControlFlowGraph, "[]", RUBY_METHOD_FUNC(cfg_lookup), 1);
+		rb_define_method(rb_cControlFlowGraph, "vertex", RUBY_METHOD_FUNC(cfg_vertex), 1);
+		rb_define_method(rb_cControlFlowGraph, "vertices", RUBY_METHOD_FUNC(cfg_vertices), 0);
+		rb_define_method(rb_cControlFlowGraph, "to_a", RUBY_METHOD_FUNC(cfg_vertices), 0);
+		rb_define_method(rb_cControlFlowGraph, "each_vertex", RUBY_METHOD_FUNC(cfg_each_vertex), 0);
+		rb_define_method(rb_cControlFlowGraph, "each", RUBY_METHOD_FUNC(cfg_each_vertex), 0);
+		rb_define_method(rb_cControlFlowGraph, "edges", RUBY_METHOD_FUNC(cfg_edges), 0);
+		rb_define_method(rb_cControlFlowGraph, "each_edge", RUBY_METHOD_FUNC(cfg_each_edge), 0);
+		rb_define_method(rb_cControlFlowGraph, "num_vertices", RUBY_METHOD_FUNC(cfg_num_vertices), 0);
+		rb_define_method(rb_cControlFlowGraph, "size", RUBY_METHOD_FUNC(cfg_num_vertices), 0);
+		rb_define_method(rb_cControlFlowGraph, "num_edges", RUBY_METHOD_FUNC(cfg_num_edges), 0);
+		rb_define_method(rb_cControlFlowGraph, "id_limit", RUBY_METHOD_FUNC(cfg_id_limit), 0);
+		rb_define_method(rb_cControlFlowGraph, "empty?", RUBY_METHOD_FUNC(cfg_empty), 0);
+		rb_define_method(rb_cControlFlowGraph, "has_vertex?", RUBY_METHOD_FUNC(cfg_has_vertex), 1);
+		rb_define_method(rb_cControlFlowGraph, "has_edge?", RUBY_METHOD_FUNC(cfg_has_edge), 2);
+		rb_define_method(rb_cControlFlowGraph, "in_degree", RUBY_METHOD_FUNC(cfg_in_degree), 1);
+		rb_define_method(rb_cControlFlowGraph, "out_degree", RUBY_METHOD_FUNC(cfg_out_degree), 1);
+		rb_define_method(rb_cControlFlowGraph, "post_order", RUBY_METHOD_FUNC(cfg_post_order), 0);
+		rb_define_method(rb_cControlFlowGraph, "reverse_post_order", RUBY_METHOD_FUNC(cfg_reverse_post_order), 0);
+		rb_define_method(rb_cControlFlowGraph, "each_reverse_post_order", RUBY_METHOD_FUNC(cfg_each_reverse_post_order), 0);
+		rb_define_method(rb_cControlFlowGraph, "reachable?", RUBY_METHOD_FUNC(cfg_reachable), 1);
+		rb_define_method(rb_cControlFlowGraph, "unreachable_vertices", RUBY_METHOD_FUNC(cfg_unreachable_vertices), 0);
+		rb_define_method(rb_cControlFlowGraph, "kill_unexecuted_edges", RUBY_METHOD_FUNC(cfg_kill_unexecuted_edges), -1);
+		rb_define_method(rb_cControlFlowGraph, "entered_overlay", RUBY_METHOD_FUNC(cfg_entered_overlay), 0);
+
+		rb_define_method(rb_cBasicBlock, "post_order_number", RUBY_METHOD_FUNC(bb_post_order_number), 0);
+		rb_define_method(rb_cBasicBlock, "reverse_post_order_number", RUBY_METHOD_FUNC(bb_reverse_post_order_number), 0);
+		rb_define_method(rb_cBasicBlock, "preorder_number", RUBY_METHOD_FUNC(bb_preorder_number), 0);
+		rb_define_method(rb_cBasicBlock, "dfs_parent", RUBY_METHOD_FUNC(bb_dfs_parent), 0);
+	}
+}
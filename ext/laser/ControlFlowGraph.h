@@ -0,0 +1,144 @@
+#ifndef LASER_CONTROL_FLOW_GRAPH_H_
+#define LASER_CONTROL_FLOW_GRAPH_H_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "BasicBlock.h"
+#include "ruby.h"
+
+namespace Laser {
+	// The vertex and edge container behind RGL::ControlFlowGraph.
+	//
+	// The graph owns every block added to it: blocks get a small, dense ID
+	// (reused after removal) and are freed together with the graph. Since
+	// Ruby may sweep a graph before the blocks it owns, the graph is
+	// reference counted by its own wrapper and by the wrapper of each block
+	// it has adopted, and is destroyed when the last of them is freed.
+	// While any of those blocks is reachable, it keeps the graph's wrapper
+	// alive.
+	class Overlay;
+	class LoopForest;
+	class ControlFlowGraph {
+	  public:
+		ControlFlowGraph() : _representation(Qnil), _entry(NULL), _num_vertices(0), _refs(1), _traversal_valid(false),
+		                     _dominators_valid(false), _post_order_array(Qnil), _reverse_post_order_array(Qnil),
+		                     _overlay(NULL), _edge_removals(0), _edge_generation(0), _loops(NULL) {}
+
+		// Adopts the block and gives it an ID. Adding a block twice is a no-op.
+		void add_vertex(BasicBlock* block);
+		// Adopts the block under a specific ID, which must be free.
+		void add_vertex_at(BasicBlock* block, uint32_t id);
+		// Disconnects the block and frees its ID. The graph retains its memory
+		// until the graph is freed.
+		void remove_vertex(BasicBlock* block);
+		BasicBlock* vertex_with_name(VALUE name);
+		inline bool has_vertex(BasicBlock* block) {
+			return block->graph() == this && block->id() != BasicBlock::NO_ID;
+		}
+
+		// One past the largest ID in use: analyses can size per-block arrays
+		// with it and index them by BasicBlock::id().
+		inline size_t id_limit() { return _blocks.size(); }
+		// The vertex with the given ID, or NULL if that ID is free.
+		inline BasicBlock* vertex(size_t id) { return _blocks[id]; }
+		inline size_t num_vertices() { return _num_vertices; }
+		size_t num_edges();
+		// Recreates every edge of source in this graph, which must hold a
+		// copy of each of source's blocks under the same ID. Flags and the
+		// order of every adjacency list are preserved, so phi nodes in the
+		// copies line up with their predecessors.
+		void copy_edges(ControlFlowGraph& source);
+
+		// The first vertex added; RGL::ControlFlowGraph adds Enter first.
+		inline BasicBlock* entry() { return _entry; }
+
+		// Numbers the blocks reachable from the entry over real edges in
+		// depth-first preorder and post-order, iteratively. The result is
+		// cached until an edge, an edge's flags, or the vertex set changes.
+		void compute_traversal();
+		inline void invalidate_traversal() {
+			++_edge_generation;
+			_traversal_valid = false;
+			_post_order_array = _reverse_post_order_array = Qnil;
+		}
+		// Bumped along with the traversal, for analyses cached elsewhere.
+		inline uint64_t edge_generation() { return _edge_generation; }
+		inline std::vector<BasicBlock*>& post_order() {
+			compute_traversal();
+			return _post_order;
+		}
+		inline bool reachable(BasicBlock* block) {
+			compute_traversal();
+			return has_vertex(block) && block->_preorder != BasicBlock::NO_ID;
+		}
+		// Sets the bit of each block ID reachable from the entry.
+		void reachable_set(Bitset& result);
+		// The edges that are neither executable nor fake.
+		void unexecuted_edges(std::vector<BasicBlock::Edge*>& result);
+		// Whether the blocks hold the dominator tree rooted at the entry.
+		// Like the traversal, it only depends on the real edges, but edge
+		// edits keep it up to date where they can (see IncrementalDominators).
+		inline bool dominators_valid() { return _dominators_valid; }
+		inline void invalidate_dominators() { _dominators_valid = false; }
+		inline void set_dominators_valid(bool valid) { _dominators_valid = valid; }
+		// The loop nesting forest, kept up to date with the real edges.
+		LoopForest& loops();
+		// Frozen Arrays of the reachable blocks' wrappers, cached alongside
+		// the traversal.
+		VALUE post_order_array();
+		VALUE reverse_post_order_array();
+
+		// The overlay entered on the graph, if any: it records the graph's
+		// flags for each edge before they first change.
+		inline Overlay* overlay() { return _overlay; }
+		inline void set_overlay(Overlay* overlay) { _overlay = overlay; }
+		// Counts the edges freed between the graph's blocks, which makes
+		// the overlays that are not entered stale.
+		inline uint64_t edge_removals() { return _edge_removals; }
+		void edge_removed(BasicBlock::Edge* edge);
+
+		inline void retain() { ++_refs; }
+		// Drops a reference, destroying the graph and all its blocks when
+		// none remain.
+		void release();
+
+		inline VALUE representation() { return _representation; }
+		inline void set_representation(VALUE representation) { _representation = representation; }
+
+		void mark();
+		void compact();
+		// The heap held by the graph itself; blocks report their own.
+		size_t memsize();
+
+	  private:
+		~ControlFlowGraph();
+		void unregister_name(BasicBlock* block);
+
+		VALUE _representation;
+		BasicBlock* _entry;
+		std::vector<BasicBlock*> _blocks;
+		std::vector<uint32_t> _free_ids;
+		std::vector<BasicBlock*> _owned;
+		std::unordered_map<std::string, BasicBlock*> _names;
+		size_t _num_vertices;
+		size_t _refs;
+
+		bool _traversal_valid;
+		bool _dominators_valid;
+		std::vector<BasicBlock*> _post_order;
+		VALUE _post_order_array;
+		VALUE _reverse_post_order_array;
+		Overlay* _overlay;
+		uint64_t _edge_removals;
+		uint64_t _edge_generation;
+		LoopForest* _loops;
+	};
+}
+extern VALUE rb_cControlFlowGraph;
+extern "C" {
+	extern const rb_data_type_t control_flow_graph_type;
+	void Init_ControlFlowGraph();
+}
+
+#endif
@@ -0,0 +1,806 @@
+#include "Dominators.h"
+#include "ControlFlowGraph.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "ruby.h"
+
+VALUE rb_cPostDominators;
+
+using namespace Laser;
+
+static unsigned long dominator_generation = 0;
+const uint32_t DominatorSnapshot::NONE;
+
+// Post-order over real edges is taken from the graph's cached traversal
+// when start is its entry, and otherwise computed iteratively so deep CFGs
+// can't blow the stack.
+DominatorSnapshot::DominatorSnapshot(BasicBlock* start, const std::unordered_set<BasicBlock*>* within,
+                                     bool reverse)
+    : _start(start) {
+	using namespace std;
+	ControlFlowGraph* graph = start->graph();
+	bool from_entry = !reverse && within == NULL && graph && graph->entry() == start;
+	unordered_map<BasicBlock*, uint32_t> numbers;
+	if (from_entry) {
+		_blocks = graph->post_order();
+	} else {
+		vector<pair<BasicBlock*, size_t> > stack;
+		numbers[start] = NONE;
+		stack.push_back(make_pair(start, 0));
+		while (!stack.empty()) {
+			BasicBlock* block = stack.back().first;
+			size_t& next = stack.back().second;
+			vector<BasicBlock::Edge*>& succs = reverse ? block->predecessors() : block->successors();
+			bool descended = false;
+			while (next < succs.size()) {
+				BasicBlock::Edge* edge = succs[next++];
+				BasicBlock* succ = reverse ? edge->from : edge->to;
+				if ((edge->flags & EDGE_FAKE) == 0 && (within == NULL || within->count(succ)) &&
+				    numbers.insert(make_pair(succ, NONE)).second) {
+					stack.push_back(make_pair(succ, 0));
+					descended = true;
+					break;
+				}
+			}
+			if (!descended) {
+				numbers[block] = _blocks.size();
+				_blocks.push_back(block);
+				stack.pop_back();
+			}
+		}
+	}
+
+	// Predecessors outside the tree are dropped, but still count towards
+	// whether a block is a join point.
+	size_t size = _blocks.size();
+	_preds.resize(size);
+	for (size_t i = 0; i < size; ++i) {
+		vector<BasicBlock::Edge*>& preds = reverse ? _blocks[i]->successors() : _blocks[i]->predecessors();
+		for (vector<BasicBlock::Edge*>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+			if ((*pred)->flags & EDGE_FAKE) {
+				continue;
+			}
+			BasicBlock* other = reverse ? (*pred)->to : (*pred)->from;
+			uint32_t number = NONE;
+			if (from_entry) {
+				uint32_t candidate = other->post_order_number();
+				if (candidate < size && _blocks[candidate] == other) {
+					number = candidate;
+				}
+			} else {
+				unordered_map<BasicBlock*, uint32_t>::iterator found = numbers.find(other);
+				if (found != numbers.end()) {
+					number = found->second;
+				}
+			}
+			_preds[i].push_back(number);
+		}
+	}
+}
+
+void DominatorSnapshot::solve() {
+	using namespace std;
+	size_t size = _blocks.size();
+	_idoms.assign(size, NONE);
+	_children.assign(size, vector<uint32_t>());
+	_tree_pre.resize(size);
+	_tree_post.resize(size);
+	if (size == 0) {
+		return;
+	}
+	uint32_t root = size - 1;
+	_idoms[root] = root;
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		// Reverse post-order, skipping the start node.
+		for (uint32_t block = root; block-- > 0; ) {
+			uint32_t new_idom = NONE;
+			vector<uint32_t>& preds = _preds[block];
+			for (vector<uint32_t>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+				uint32_t other = *pred;
+				if (other == NONE || _idoms[other] == NONE) {
+					continue;
+				}
+				if (new_idom == NONE) {
+					new_idom = other;
+				} else {
+					uint32_t finger1 = other;
+					uint32_t finger2 = new_idom;
+					while (finger1 != finger2) {
+						while (finger1 < finger2) {
+							finger1 = _idoms[finger1];
+						}
+						while (finger2 < finger1) {
+							finger2 = _idoms[finger2];
+						}
+					}
+					new_idom = finger1;
+				}
+			}
+			if (new_idom != _idoms[block]) {
+				_idoms[block] = new_idom;
+				changed = true;
+			}
+		}
+	}
+
+	// Link the tree in reverse post-order, then number it.
+	_idoms[root] = NONE;
+	for (uint32_t block = root; block-- > 0; ) {
+		_children[_idoms[block]].push_back(block);
+	}
+	uint32_t counter = 0;
+	vector<pair<uint32_t, size_t> > stack;
+	_tree_pre[root] = counter++;
+	stack.push_back(make_pair(root, 0));
+	while (!stack.empty()) {
+		uint32_t block = stack.back().first;
+		size_t& next = stack.back().second;
+		if (next < _children[block].size()) {
+			uint32_t child = _children[block][next++];
+			_tree_pre[child] = counter++;
+			stack.push_back(make_pair(child, 0));
+		} else {
+			_tree_post[block] = counter++;
+			stack.pop_back();
+		}
+	}
+}
+
+// Cytron et al.: each predecessor of a join point, and its dominators up
+// to the join point's idom, have the join point in their frontier.
+// Predecessors outside the tree are NONE, so they only count towards
+// whether a block is a join point.
+void DominatorSnapshot::solve_frontiers() {
+	using namespace std;
+	size_t size = _blocks.size();
+	_frontiers.assign(size, Bitset(size));
+	for (uint32_t block = 0; block < size; ++block) {
+		if (_idoms[block] == NONE || _preds[block].size() < 2) {
+			continue;
+		}
+		vector<uint32_t>& preds = _preds[block];
+		for (vector<uint32_t>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+			for (uint32_t runner = *pred; runner != NONE && runner != _idoms[block]; runner = _idoms[runner]) {
+				_frontiers[runner].set(block);
+			}
+		}
+	}
+}
+
+void DominatorSnapshot::attach() {
+	unsigned long generation = ++dominator_generation;
+	for (size_t i = 0; i < _blocks.size(); ++i) {
+		BasicBlock* block = _blocks[i];
+		block->_dom_root = _start;
+		block->_dom_generation = generation;
+		block->_dom_post_order = i;
+		block->_dom_tree_pre = _tree_pre[i];
+		block->_dom_tree_post = _tree_post[i];
+		block->_idom = (_idoms[i] == NONE) ? NULL : _blocks[_idoms[i]];
+		block->_dominated.clear();
+		for (std::vector<uint32_t>::iterator child = _children[i].begin(); child < _children[i].end(); ++child) {
+			block->_dominated.push_back(_blocks[*child]);
+		}
+	}
+	_start->_dom_order = _blocks;
+	_start->_dom_numbered = true;
+	if (_frontiers.size() == _blocks.size() && !_blocks.empty()) {
+		for (size_t i = 0; i < _blocks.size(); ++i) {
+			std::swap(_blocks[i]->_frontier, _frontiers[i]);
+		}
+		_frontiers.clear();
+		_start->_frontier_generation = generation;
+	}
+	ControlFlowGraph* graph = _start->graph();
+	if (graph) {
+		graph->set_dominators_valid(graph->entry() == _start);
+	}
+}
+
+void DominatorSnapshot::reattach(std::vector<BasicBlock*>& previous) {
+	BasicBlock* root = _start->_dom_root;
+	BasicBlock* parent = _start->_idom;
+	for (std::vector<BasicBlock*>::iterator it = previous.begin(); it < previous.end(); ++it) {
+		(*it)->_dom_root = NULL;
+		(*it)->_idom = NULL;
+		(*it)->_dominated.clear();
+	}
+	for (size_t i = 0; i < _blocks.size(); ++i) {
+		BasicBlock* block = _blocks[i];
+		block->_dom_root = root;
+		block->_idom = (_idoms[i] == NONE) ? parent : _blocks[_idoms[i]];
+		for (std::vector<uint32_t>::iterator child = _children[i].begin(); child < _children[i].end(); ++child) {
+			block->_dominated.push_back(_blocks[*child]);
+		}
+	}
+}
+
+size_t DominatorSnapshot::memsize() {
+	size_t size = sizeof(DominatorSnapshot) + _blocks.capacity() * sizeof(BasicBlock*);
+	size += (_idoms.capacity() + _tree_pre.capacity() + _tree_post.capacity()) * sizeof(uint32_t);
+	for (size_t i = 0; i < _preds.size(); ++i) {
+		size += sizeof(_preds[i]) + _preds[i].capacity() * sizeof(uint32_t);
+	}
+	for (size_t i = 0; i < _children.size(); ++i) {
+		size += sizeof(_children[i]) + _children[i].capacity() * sizeof(uint32_t);
+	}
+	for (size_t i = 0; i < _frontiers.size(); ++i) {
+		size += _frontiers[i].memsize();
+	}
+	return size;
+}
+
+// The graph whose entry's tree an edit between the two blocks must keep
+// up to date, if any. An edit between graphs gives up on both.
+ControlFlowGraph* IncrementalDominators::maintained_graph(BasicBlock* from, BasicBlock* to) {
+	ControlFlowGraph* graph = from->graph();
+	if (graph != to->graph()) {
+		if (graph) {
+			graph->invalidate_dominators();
+		}
+		if (to->graph()) {
+			to->graph()->invalidate_dominators();
+		}
+		return NULL;
+	}
+	return (graph && graph->dominators_valid()) ? graph : NULL;
+}
+
+bool IncrementalDominators::in_tree(ControlFlowGraph* graph, BasicBlock* block) {
+	return block->_dom_root == graph->entry() && block->has_dominator_info();
+}
+
+void IncrementalDominators::reshaped(BasicBlock* root) {
+	root->_dom_numbered = false;
+	root->_frontier_generation = 0;
+}
+
+void IncrementalDominators::resolve_subtree(BasicBlock* top) {
+	std::vector<BasicBlock*> previous(1, top);
+	for (size_t i = 0; i < previous.size(); ++i) {
+		std::vector<BasicBlock*>& children = previous[i]->_dominated;
+		previous.insert(previous.end(), children.begin(), children.end());
+	}
+	std::unordered_set<BasicBlock*> within(previous.begin(), previous.end());
+	DominatorSnapshot snapshot(top, &within);
+	snapshot.solve();
+	snapshot.reattach(previous);
+	reshaped(top->_dom_root);
+}
+
+// A new real edge from a block in the tree either reaches new blocks, or
+// can only pull idoms up to nca(from, to). If that is to's idom already, or
+// to itself, only the frontiers change.
+void IncrementalDominators::edge_added(BasicBlock* from, BasicBlock* to, uint8_t flags) {
+	ControlFlowGraph* graph = maintained_graph(from, to);
+	if (graph == NULL || (flags & EDGE_FAKE) || !in_tree(graph, from)) {
+		return;
+	}
+	if (!in_tree(graph, to)) {
+		graph->invalidate_dominators();
+		return;
+	}
+	BasicBlock* root = graph->entry();
+	number_tree(root);
+	BasicBlock* ancestor = from;
+	while (!ancestor->dominates(to)) {
+		ancestor = ancestor->_idom;
+	}
+	if (ancestor == to || ancestor == to->_idom) {
+		root->_frontier_generation = 0;
+	} else {
+		resolve_subtree(ancestor);
+	}
+}
+
+// Removing a real edge can only push idoms down within the subtree of
+// to's idom, and only if to doesn't dominate from: a back edge carries no
+// path to to that doesn't already pass through it. If to's subtree is cut
+// off, its edges out of the subtree go too, so the subtree re-solved must
+// also hold their targets.
+void IncrementalDominators::edge_removed(BasicBlock* from, BasicBlock* to, uint8_t flags) {
+	using namespace std;
+	ControlFlowGraph* graph = maintained_graph(from, to);
+	if (graph == NULL || (flags & EDGE_FAKE) || !in_tree(graph, to)) {
+		return;
+	}
+	BasicBlock* root = graph->entry();
+	number_tree(root);
+	if (!in_tree(graph, from) || to->dominates(from)) {
+		root->_frontier_generation = 0;
+		return;
+	}
+	BasicBlock* top = to->_idom;
+	vector<BasicBlock*> subtree(1, to);
+	for (size_t i = 0; i < subtree.size(); ++i) {
+		BasicBlock* block = subtree[i];
+		vector<BasicBlock::Edge*>& succs = block->successors();
+		for (vector<BasicBlock::Edge*>::iterator succ = succs.begin(); succ < succs.end(); ++succ) {
+			BasicBlock* other = (*succ)->to;
+			if (((*succ)->flags & EDGE_FAKE) == 0 && in_tree(graph, other) && !to->dominates(other)) {
+				while (!top->dominates(other)) {
+					top = top->_idom;
+				}
+			}
+		}
+		subtree.insert(subtree.end(), block->_dominated.begin(), block->_dominated.end());
+	}
+	resolve_subtree(top);
+}
+
+// The inserted block joins the tree under from, and takes over as to's
+// idom if every other path to to already ran through from -> to.
+void IncrementalDominators::block_inserted(BasicBlock* from, BasicBlock* inserted, BasicBlock* to,
+                                           uint8_t flags) {
+	using namespace std;
+	ControlFlowGraph* graph = maintained_graph(from, to);
+	if (graph == NULL) {
+		return;
+	}
+	if (inserted->graph() != graph) {
+		graph->invalidate_dominators();
+		return;
+	}
+	if ((flags & EDGE_FAKE) || !in_tree(graph, from)) {
+		return;
+	}
+	if (in_tree(graph, inserted) || inserted->predecessors().size() != 1 ||
+	    inserted->successors().size() != 1) {
+		graph->invalidate_dominators();
+		return;
+	}
+	BasicBlock* root = graph->entry();
+	number_tree(root);
+	bool takes_over = to->_idom == from;
+	vector<BasicBlock::Edge*>& preds = to->predecessors();
+	for (vector<BasicBlock::Edge*>::iterator pred = preds.begin(); takes_over && pred < preds.end(); ++pred) {
+		BasicBlock* other = (*pred)->from;
+		if (other != inserted && ((*pred)->flags & EDGE_FAKE) == 0 && in_tree(graph, other) &&
+		    !to->dominates(other)) {
+			takes_over = false;
+		}
+	}
+	inserted->_dom_root = root;
+	inserted->_dom_generation = root->_dom_generation;
+	inserted->_dom_post_order = root->_dom_order.size();
+	root->_dom_order.push_back(inserted);
+	inserted->_idom = from;
+	inserted->_dominated.clear();
+	from->_dominated.push_back(inserted);
+	if (takes_over) {
+		from->_dominated.erase(find(from->_dominated.begin(), from->_dominated.end(), to));
+		to->_idom = inserted;
+		inserted->_dominated.push_back(to);
+	}
+	reshaped(root);
+}
+
+void IncrementalDominators::number_tree(BasicBlock* root) {
+	using namespace std;
+	if (root->_dom_numbered) {
+		return;
+	}
+	uint32_t counter = 0;
+	vector<pair<BasicBlock*, size_t> > stack;
+	root->_dom_tree_pre = counter++;
+	stack.push_back(make_pair(root, 0));
+	while (!stack.empty()) {
+		BasicBlock* block = stack.back().first;
+		size_t& next = stack.back().second;
+		if (next < block->_dominated.size()) {
+			BasicBlock* child = block->_dominated[next++];
+			child->_dom_tree_pre = counter++;
+			stack.push_back(make_pair(child, 0));
+		} else {
+			block->_dom_tree_post = counter++;
+			stack.pop_back();
+		}
+	}
+	root->_dom_numbered = true;
+}
+
+void Laser::compute_dominators(BasicBlock* start) {
+	ControlFlowGraph* graph = start->graph();
+	if (graph && graph->entry() == start && graph->dominators_valid()) {
+		return;
+	}
+	DominatorSnapshot snapshot(start);
+	snapshot.solve();
+	snapshot.attach();
+}
+
+void Laser::compute_dominance_frontier(BasicBlock* root) {
+	using namespace std;
+	if (root->_frontier_generation == root->_dom_generation) {
+		return;
+	}
+	vector<BasicBlock*>& blocks = root->_dom_order;
+	for (vector<BasicBlock*>::iterator it = blocks.begin(); it < blocks.end(); ++it) {
+		(*it)->_frontier.resize(blocks.size());
+	}
+	for (vector<BasicBlock*>::iterator it = blocks.begin(); it < blocks.end(); ++it) {
+		BasicBlock* block = *it;
+		if (block->_idom == NULL) {
+			continue;
+		}
+		vector<BasicBlock::Edge*>& preds = block->predecessors();
+		size_t real_preds = 0;
+		for (vector<BasicBlock::Edge*>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+			if (((*pred)->flags & EDGE_FAKE) == 0) {
+				++real_preds;
+			}
+		}
+		if (real_preds < 2) {
+			continue;
+		}
+		for (vector<BasicBlock::Edge*>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+			BasicBlock* runner = (*pred)->from;
+			if (((*pred)->flags & EDGE_FAKE) ||
+			    runner->_dom_root != root || runner->_dom_generation != root->_dom_generation) {
+				continue;
+			}
+			while (runner != NULL && runner != block->_idom) {
+				runner->_frontier.set(block->_dom_post_order);
+				runner = runner->_idom;
+			}
+		}
+	}
+	root->_frontier_generation = root->_dom_generation;
+}
+
+void Laser::iterated_dominance_frontier(BasicBlock* root, std::vector<BasicBlock*>& set,
+                                        std::vector<BasicBlock*>& result) {
+	using namespace std;
+	compute_dominance_frontier(root);
+	vector<BasicBlock*>& blocks = root->_dom_order;
+	Bitset seen(blocks.size());
+	vector<uint32_t> worklist;
+	for (vector<BasicBlock*>::iterator it = set.begin(); it < set.end(); ++it) {
+		BasicBlock* block = *it;
+		if (block->_dom_root != root || block->_dom_generation != root->_dom_generation) {
+			// Not in the tree: it has no frontier, but DF+ still includes it.
+			if (find(result.begin(), result.end(), block) == result.end()) {
+				result.push_back(block);
+			}
+		} else if (seen.add(block->_dom_post_order)) {
+			result.push_back(block);
+			worklist.push_back(block->_dom_post_order);
+		}
+	}
+	while (!worklist.empty()) {
+		Bitset& frontier = blocks[worklist.back()]->_frontier;
+		worklist.pop_back();
+		for (size_t id = frontier.next(0); id < frontier.size(); id = frontier.next(id + 1)) {
+			if (seen.add(id)) {
+				result.push_back(blocks[id]);
+				worklist.push_back(id);
+			}
+		}
+	}
+}
+
+bool BasicBlock::dominates(BasicBlock* other) {
+	if (this == other) {
+		return true;
+	}
+	if (!has_dominator_info() || !other->has_dominator_info() ||
+	    _dom_root != other->_dom_root) {
+		return false;
+	}
+	IncrementalDominators::number_tree(_dom_root);
+	return _dom_tree_pre < other->_dom_tree_pre && other->_dom_tree_post < _dom_tree_post;
+}
+
+PostDominators::~PostDominators() {
+	delete _snapshot;
+	if (_graph) {
+		_graph->release();
+	}
+}
+
+void PostDominators::attach(BasicBlock* exit) {
+	_graph = exit->graph();
+	_graph->retain();
+	_exit = exit;
+}
+
+void PostDominators::refresh() {
+	if (_snapshot && _generation == _graph->edge_generation()) {
+		return;
+	}
+	delete _snapshot;
+	_snapshot = new DominatorSnapshot(_exit, NULL, true);
+	_snapshot->solve();
+	_generation = _graph->edge_generation();
+	_numbers.assign(_graph->id_limit(), DominatorSnapshot::NONE);
+	std::vector<BasicBlock*>& blocks = _snapshot->blocks();
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		if (_graph->has_vertex(blocks[i])) {
+			_numbers[blocks[i]->id()] = i;
+		}
+	}
+	_dependences_valid = false;
+	_dependences.clear();
+}
+
+uint32_t PostDominators::number(BasicBlock* block) {
+	refresh();
+	if (!_graph->has_vertex(block) || block->id() >= _numbers.size()) {
+		return DominatorSnapshot::NONE;
+	}
+	return _numbers[block->id()];
+}
+
+BasicBlock* PostDominators::ipdom(BasicBlock* block) {
+	uint32_t i = number(block);
+	if (i == DominatorSnapshot::NONE || _snapshot->idom(i) == DominatorSnapshot::NONE) {
+		return NULL;
+	}
+	return _snapshot->blocks()[_snapshot->idom(i)];
+}
+
+bool PostDominators::postdominates(BasicBlock* block, BasicBlock* other) {
+	if (block == other) {
+		return true;
+	}
+	uint32_t i = number(block), j = number(other);
+	return i != DominatorSnapshot::NONE && j != DominatorSnapshot::NONE && _snapshot->tree_contains(i, j);
+}
+
+// X is control dependent on each block from S up to, but not including,
+// ipdom(X) for each real edge X -> S (Cytron et al., fig. 10). Walking
+// every edge visits each dependence once per edge, so only the last entry
+// needs checking for duplicates.
+void PostDominators::compute_dependences() {
+	refresh();
+	if (_dependences_valid) {
+		return;
+	}
+	std::vector<BasicBlock*>& blocks = _snapshot->blocks();
+	_dependences.assign(blocks.size(), std::vector<uint32_t>());
+	for (uint32_t x = 0; x < blocks.size(); ++x) {
+		uint32_t stop = _snapshot->idom(x);
+		std::vector<BasicBlock::Edge*>& succs = blocks[x]->successors();
+		for (std::vector<BasicBlock::Edge*>::iterator edge = succs.begin(); edge < succs.end(); ++edge) {
+			if ((*edge)->flags & EDGE_FAKE) {
+				continue;
+			}
+			uint32_t runner = number((*edge)->to);
+			while (runner != DominatorSnapshot::NONE && runner != stop) {
+				std::vector<uint32_t>& list = _dependences[runner];
+				if (list.empty() || list.back() != x) {
+					list.push_back(x);
+				}
+				runner = _snapshot->idom(runner);
+			}
+		}
+	}
+	_dependences_valid = true;
+}
+
+void PostDominators::control_dependences(BasicBlock* block, std::vector<BasicBlock*>& result) {
+	compute_dependences();
+	uint32_t i = number(block);
+	if (i == DominatorSnapshot::NONE) {
+		return;
+	}
+	std::vector<uint32_t>& list = _dependences[i];
+	for (std::vector<uint32_t>::iterator it = list.begin(); it < list.end(); ++it) {
+		result.push_back(_snapshot->blocks()[*it]);
+	}
+}
+
+void PostDominators::mark() {
+	if (_graph) {
+		rb_gc_mark_movable(_graph->representation());
+	}
+}
+
+void PostDominators::compact() {
+	_representation = rb_gc_location(_representation);
+}
+
+size_t PostDominators::memsize() {
+	size_t size = sizeof(PostDominators) + _numbers.capacity() * sizeof(uint32_t);
+	if (_snapshot) {
+		size += _snapshot->memsize();
+	}
+	for (size_t i = 0; i < _dependences.size(); ++i) {
+		size += sizeof(_dependences[i]) + _dependences[i].capacity() * sizeof(uint32_t);
+	}
+	return size;
+}
+
+extern "C" {
+	static VALUE bb_compute_dominators(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		compute_dominators(block);
+		return self;
+	}
+
+	static VALUE bb_idom(VALUE self) {
+		BasicBlock *block, *idom;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		idom = block->idom();
+		return idom ? idom->representation() : Qnil;
+	}
+
+	static VALUE bb_dominated_children(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		VALUE result = rb_ary_new();
+		if (!block->has_dominator_info()) {
+			return result;
+		}
+		std::vector<BasicBlock*>& list = block->dominated_children();
+		for (std::vector<BasicBlock*>::iterator it = list.begin(); it < list.end(); ++it) {
+			rb_ary_push(result, (*it)->representation());
+		}
+		return result;
+	}
+
+	static VALUE bb_dominates(VALUE self, VALUE other) {
+		BasicBlock *block, *other_block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(other, BasicBlock, &basic_block_type, other_block);
+		return block->dominates(other_block) ? Qtrue : Qfalse;
+	}
+
+	static VALUE bb_dominance_frontier(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		VALUE result = rb_ary_new();
+		if (!block->has_dominator_info()) {
+			return result;
+		}
+		BasicBlock *root = block->dominator_root();
+		compute_dominance_frontier(root);
+		Bitset& frontier = block->dominance_frontier();
+		std::vector<BasicBlock*>& blocks = root->dominator_order();
+		for (size_t id = frontier.next(0); id < frontier.size(); id = frontier.next(id + 1)) {
+			rb_ary_push(result, blocks[id]->representation());
+		}
+		return result;
+	}
+
+	// Takes an array of arrays of blocks, such as the definition blocks of
+	// each global temp, and returns the DF+ of each one in one pass.
+	static VALUE bb_iterated_dominance_frontiers(VALUE self, VALUE sets) {
+		BasicBlock *root;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, root);
+		if (!root->has_dominator_info() || root->dominator_root() != root) {
+			rb_raise(rb_eArgError, "Dominators have not been computed from this block.");
+		}
+		sets = rb_convert_type(sets, T_ARRAY, "Array", "to_a");
+		long num_sets = RARRAY_LEN(sets);
+		VALUE result = rb_ary_new2(num_sets);
+		std::vector<BasicBlock*> set, frontier;
+		for (long i = 0; i < num_sets; ++i) {
+			VALUE blocks = rb_convert_type(rb_ary_entry(sets, i), T_ARRAY, "Array", "to_a");
+			set.clear();
+			frontier.clear();
+			for (long j = 0; j < RARRAY_LEN(blocks); ++j) {
+				BasicBlock *block;
+				TypedData_Get_Struct(rb_ary_entry(blocks, j), BasicBlock, &basic_block_type, block);
+				set.push_back(block);
+			}
+			iterated_dominance_frontier(root, set, frontier);
+			VALUE output = rb_ary_new2(frontier.size());
+			for (std::vector<BasicBlock*>::iterator it = frontier.begin(); it < frontier.end(); ++it) {
+				rb_ary_push(output, (*it)->representation());
+			}
+			rb_ary_push(result, output);
+		}
+		return result;
+	}
+
+	static void post_dominators_mark(void* p) {
+		((PostDominators*)p)->mark();
+	}
+
+	static void post_dominators_free(void* p) {
+		delete (PostDominators*)p;
+	}
+
+	static size_t post_dominators_memsize(const void* p) {
+		return ((PostDominators*)p)->memsize();
+	}
+
+	static void post_dominators_compact(void* p) {
+		((PostDominators*)p)->compact();
+	}
+
+	static const rb_data_type_t post_dominators_type = {
+		"Laser::Analysis::ControlFlow::PostDominators",
+		{ post_dominators_mark, post_dominators_free, post_dominators_memsize,
+		  LASER_DCOMPACT(post_dominators_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE post_dominators_alloc(VALUE klass) {
+		PostDominators *tree = new PostDominators;
+		VALUE result = TypedData_Wrap_Struct(klass, &post_dominators_type, tree);
+		tree->set_representation(result);
+		return result;
+	}
+
+	static PostDominators* post_dominators_attached(VALUE self) {
+		PostDominators *tree;
+		TypedData_Get_Struct(self, PostDominators, &post_dominators_type, tree);
+		if (!tree->exit()) {
+			rb_raise(rb_eRuntimeError, "The postdominator tree has no exit.");
+		}
+		return tree;
+	}
+
+	static BasicBlock* post_dominators_block(VALUE block) {
+		BasicBlock *result;
+		TypedData_Get_Struct(block, BasicBlock, &basic_block_type, result);
+		return result;
+	}
+
+	static VALUE post_dominators_initialize(VALUE self, VALUE exit) {
+		PostDominators *tree;
+		BasicBlock *block;
+		TypedData_Get_Struct(self, PostDominators, &post_dominators_type, tree);
+		TypedData_Get_Struct(exit, BasicBlock, &basic_block_type, block);
+		if (tree->exit()) {
+			rb_raise(rb_eRuntimeError, "The postdominator tree already has an exit.");
+		}
+		if (!block->graph() || !block->graph()->has_vertex(block)) {
+			rb_raise(rb_eArgError, "The exit block is not in a graph.");
+		}
+		tree->attach(block);
+		return Qnil;
+	}
+
+	static VALUE post_dominators_exit(VALUE self) {
+		return post_dominators_attached(self)->exit()->representation();
+	}
+
+	static VALUE post_dominators_ipdom(VALUE self, VALUE block) {
+		PostDominators *tree = post_dominators_attached(self);
+		BasicBlock *ipdom = tree->ipdom(post_dominators_block(block));
+		return ipdom ? ipdom->representation() : Qnil;
+	}
+
+	static VALUE post_dominators_postdominates(VALUE self, VALUE block, VALUE other) {
+		PostDominators *tree = post_dominators_attached(self);
+		return tree->postdominates(post_dominators_block(block), post_dominators_block(other))
+		       ? Qtrue : Qfalse;
+	}
+
+	static VALUE post_dominators_control_dependences(VALUE self, VALUE block) {
+		PostDominators *tree = post_dominators_attached(self);
+		std::vector<BasicBlock*> list;
+		tree->control_dependences(post_dominators_block(block), list);
+		VALUE result = rb_ary_new2(list.size());
+		for (std::vector<BasicBlock*>::iterator it = list.begin(); it < list.end(); ++it) {
+			rb_ary_push(result, (*it)->representation());
+		}
+		return result;
+	}
+
+	void Init_Dominators() {
+		rb_define_method(rb_cBasicBlock, "compute_dominators", RUBY_METHOD_FUNC(bb_compute_dominators), 0);
+		rb_define_method(rb_cBasicBlock, "idom", RUBY_METHOD_FUNC(bb_idom), 0);
+		rb_define_method(rb_cBasicBlock, "dominated_children", RUBY_METHOD_FUNC(bb_dominated_children), 0);
+		rb_define_method(rb_cBasicBlock, "dominates?", RUBY_METHOD_FUNC(bb_dominates), 1);
+		rb_define_method(rb_cBasicBlock, "dominance_frontier", RUBY_METHOD_FUNC(bb_dominance_frontier), 0);
+		rb_define_method(rb_cBasicBlock, "iterated_dominance_frontiers", RUBY_METHOD_FUNC(bb_iterated_dominance_frontiers), 1);
+
+		rb_cPostDominators = rb_define_class_under(rb_mControlFlow, "PostDominators", rb_cObject);
+		rb_define_alloc_func(rb_cPostDominators, post_dominators_alloc);
+		rb_define_method(rb_cPostDominators, "initialize", RUBY_METHOD_FUNC(post_dominators_initialize), 1);
+		rb_define_method(rb_cPostDominators, "exit", RUBY_METHOD_FUNC(post_dominators_exit), 0);
+		rb_define_method(rb_cPostDominators, "ipdom", RUBY_METHOD_FUNC(post_dominators_ipdom), 1);
+		rb_define_method(rb_cPostDominators, "postdominates?", RUBY_METHOD_FUNC(post_dominators_postdominates), 2);
+		rb_define_method(rb_cPostDominators, "control_dependences", RUBY_METHOD_FUNC(post_dominators_control_dependences), 1);
+	}
+}
@@ -0,0 +1,146 @@
+#ifndef LASER_DOMINATORS_H_
+#define LASER_DOMINATORS_H_
+
+#include <vector>
+#include <unordered_set>
+#include "BasicBlock.h"
+
+namespace Laser {
+	// The blocks reachable from a start block over non-fake edges, in
+	// post-order, with their predecessors copied out as post-order numbers.
+	// Reversed, it follows the edges backwards, for postdominators.
+	//
+	// Capturing and attaching touch the blocks, so they need the GVL.
+	// Solving reads and writes only the snapshot, so the snapshots of
+	// different graphs can be solved in parallel without it.
+	class DominatorSnapshot {
+	  public:
+		static const uint32_t NONE = ~(uint32_t)0;
+		// With within given, only the blocks in it are followed: the
+		// subtree of start being re-solved after an edit.
+		explicit DominatorSnapshot(BasicBlock* start,
+		                           const std::unordered_set<BasicBlock*>* within = NULL,
+		                           bool reverse = false);
+		// Cooper, Harvey, and Kennedy: "A Simple, Fast Dominance Algorithm",
+		// then numbers the tree so dominance queries are an interval check.
+		void solve();
+		// Fills in the dominance frontiers from the solution, as
+		// compute_dominance_frontier would on the blocks. Like solve, it
+		// reads and writes only the snapshot.
+		void solve_frontiers();
+		// Stores the solution on the blocks and links the dominator tree,
+		// along with the frontiers if they were solved.
+		void attach();
+		// Stores the solution for a subtree re-solved in place, keeping
+		// start's idom. Blocks of the previous subtree no longer reached
+		// leave the tree.
+		void reattach(std::vector<BasicBlock*>& previous);
+
+		// The solution, by post-order number: each block's idom, NONE for
+		// the start, and its interval in the numbered tree.
+		inline std::vector<BasicBlock*>& blocks() { return _blocks; }
+		inline uint32_t idom(uint32_t block) { return _idoms[block]; }
+		inline bool tree_contains(uint32_t block, uint32_t other) {
+			return _tree_pre[block] <= _tree_pre[other] && _tree_post[other] <= _tree_post[block];
+		}
+		size_t memsize();
+
+	  private:
+		BasicBlock* _start;
+		std::vector<BasicBlock*> _blocks;
+		std::vector<std::vector<uint32_t> > _preds;
+		std::vector<uint32_t> _idoms;
+		std::vector<uint32_t> _tree_pre;
+		std::vector<uint32_t> _tree_post;
+		std::vector<std::vector<uint32_t> > _children;
+		std::vector<Bitset> _frontiers;
+	};
+
+	// Keeps the dominator tree rooted at a graph's entry valid across edge
+	// edits, called after each edit. An edge u -> v can only change the
+	// idoms of blocks below nca(u, v) in the tree (Ramalingam and Reps), so
+	// only that subtree is re-solved. Edits that reach new blocks mark the
+	// graph's dominators invalid instead. The frontiers and the tree's
+	// interval numbering are rebuilt lazily, on the next query.
+	class IncrementalDominators {
+	  public:
+		static void edge_added(BasicBlock* from, BasicBlock* to, uint8_t flags);
+		static void edge_removed(BasicBlock* from, BasicBlock* to, uint8_t flags);
+		// inserted was placed on an edge from -> to with the given flags.
+		static void block_inserted(BasicBlock* from, BasicBlock* inserted, BasicBlock* to,
+		                           uint8_t flags);
+		// Renumbers root's tree for interval dominance checks if edits
+		// have changed its shape since it was last numbered.
+		static void number_tree(BasicBlock* root);
+
+	  private:
+		static ControlFlowGraph* maintained_graph(BasicBlock* from, BasicBlock* to);
+		static bool in_tree(ControlFlowGraph* graph, BasicBlock* block);
+		static void resolve_subtree(BasicBlock* top);
+		static void reshaped(BasicBlock* root);
+	};
+
+	// The postdominator tree of a graph: the dominators of its reversed
+	// non-fake edges from its exit, and the control dependences derived
+	// from them, which are the postdominance frontiers (Cytron et al.).
+	// Blocks that cannot reach the exit are not in the tree. Unlike the
+	// dominators, the solution is kept here rather than on the blocks, and
+	// is rebuilt by the first query after the graph's edges change.
+	class PostDominators {
+	  public:
+		PostDominators() : _exit(NULL), _graph(NULL), _representation(Qnil), _generation(0),
+		                   _snapshot(NULL), _dependences_valid(false) {}
+		~PostDominators();
+		// The exit must be in a graph.
+		void attach(BasicBlock* exit);
+		inline BasicBlock* exit() { return _exit; }
+		inline ControlFlowGraph* graph() { return _graph; }
+		inline VALUE representation() { return _representation; }
+		inline void set_representation(VALUE representation) { _representation = representation; }
+
+		// NULL for the exit and for blocks not in the tree.
+		BasicBlock* ipdom(BasicBlock* block);
+		// Whether every path from other to the exit passes through block.
+		bool postdominates(BasicBlock* block, BasicBlock* other);
+		// The blocks with a successor that decides whether block runs.
+		void control_dependences(BasicBlock* block, std::vector<BasicBlock*>& result);
+
+		void mark();
+		void compact();
+		size_t memsize();
+
+	  private:
+		void refresh();
+		uint32_t number(BasicBlock* block);
+		void compute_dependences();
+
+		BasicBlock* _exit;
+		ControlFlowGraph* _graph;
+		VALUE _representation;
+		// The graph's edge generation the solution was built at.
+		uint64_t _generation;
+		DominatorSnapshot* _snapshot;
+		// Post-order numbers by block ID.
+		std::vector<uint32_t> _numbers;
+		bool _dependences_valid;
+		std::vector<std::vector<uint32_t> > _dependences;
+	};
+
+	// Computes the immediate dominator of every block reachable from start
+	// over non-fake edges, and links each block into the dominator tree.
+	// From a graph's entry, the tree is kept up to date as edges change.
+	void compute_dominators(BasicBlock* start);
+	// Computes the dominance frontier of every block in root's dominator
+	// tree as a bitset over post-order numbers. Cached until the dominators
+	// are recomputed or updated.
+	void compute_dominance_frontier(BasicBlock* root);
+	// Computes DF+ of the given blocks, which includes the blocks themselves.
+	void iterated_dominance_frontier(BasicBlock* root, std::vector<BasicBlock*>& set,
+	                                 std::vector<BasicBlock*>& result);
+}
+extern VALUE rb_cPostDominators;
+extern "C" {
+	void Init_Dominators();
+}
+
+#endif
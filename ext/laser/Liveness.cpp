@@ -0,0 +1,415 @@
+#include "Liveness.h"
+#include <utility>
+#include "ruby.h"
+
+VALUE rb_cLiveness;
+
+using namespace Laser;
+
+long Liveness::intern_temp(VALUE temp) {
+	VALUE id = rb_hash_lookup2(_temp_ids, temp, Qnil);
+	if (id != Qnil) {
+		return FIX2LONG(id);
+	}
+	long new_id = RARRAY_LEN(_temps);
+	rb_hash_aset(_temp_ids, temp, LONG2FIX(new_id));
+	rb_ary_push(_temps, temp);
+	return new_id;
+}
+
+long Liveness::temp_id(VALUE temp) {
+	if (_temp_ids == Qnil) {
+		return -1;
+	}
+	VALUE id = rb_hash_lookup2(_temp_ids, temp, Qnil);
+	return (id == Qnil) ? -1 : FIX2LONG(id);
+}
+
+long Liveness::block_id(BasicBlock* block) {
+	std::unordered_map<BasicBlock*, uint32_t>::iterator it = _block_ids.find(block);
+	return (it == _block_ids.end()) ? -1 : it->second;
+}
+
+void Liveness::build(VALUE blocks, VALUE uses, VALUE definitions) {
+	_temp_ids = rb_hash_new();
+	rb_funcall(_temp_ids, rb_intern("compare_by_identity"), 0);
+	_temps = rb_ary_new();
+	long num_blocks = RARRAY_LEN(blocks);
+	_blocks.resize(num_blocks);
+	for (long i = 0; i < num_blocks; ++i) {
+		BasicBlock *block;
+		TypedData_Get_Struct(rb_ary_entry(blocks, i), BasicBlock, &basic_block_type, block);
+		_blocks[i] = block;
+		_block_ids[block] = i;
+	}
+	// Only temps with an upward-exposed use can ever be live, so they are
+	// the only ones that get IDs.
+	for (long i = 0; i < num_blocks; ++i) {
+		VALUE block_uses = rb_ary_entry(uses, i);
+		for (long j = 0; j < RARRAY_LEN(block_uses); ++j) {
+			intern_temp(rb_ary_entry(block_uses, j));
+		}
+	}
+	size_t temps = num_temps();
+	_uses.assign(num_blocks, Bitset(temps));
+	_defs.assign(num_blocks, Bitset(temps));
+	for (long i = 0; i < num_blocks; ++i) {
+		VALUE block_uses = rb_ary_entry(uses, i);
+		for (long j = 0; j < RARRAY_LEN(block_uses); ++j) {
+			_uses[i].set(temp_id(rb_ary_entry(block_uses, j)));
+		}
+		VALUE block_defs = rb_ary_entry(definitions, i);
+		for (long j = 0; j < RARRAY_LEN(block_defs); ++j) {
+			long id = temp_id(rb_ary_entry(block_defs, j));
+			if (id >= 0) {
+				_defs[i].set(id);
+			}
+		}
+	}
+	solve();
+}
+
+void Liveness::translate(Liveness& source, VALUE block_lookup, VALUE temp_lookup) {
+	_temp_ids = rb_hash_new();
+	rb_funcall(_temp_ids, rb_intern("compare_by_identity"), 0);
+	_temps = rb_ary_new();
+	for (size_t id = 0; id < source.num_temps(); ++id) {
+		VALUE temp = source.temp(id);
+		intern_temp(rb_hash_lookup2(temp_lookup, temp, temp));
+	}
+	_blocks.resize(source.num_blocks());
+	for (size_t id = 0; id < source.num_blocks(); ++id) {
+		VALUE copy = RB_TYPE_P(block_lookup, T_ARRAY)
+		    ? rb_ary_entry(block_lookup, source.block(id)->id())
+		    : rb_hash_lookup2(block_lookup, source.block(id)->representation(), Qnil);
+		if (copy == Qnil) {
+			rb_raise(rb_eArgError, "No copy of block %" PRIsVALUE " was provided.",
+			         source.block(id)->name());
+		}
+		BasicBlock *block;
+		TypedData_Get_Struct(copy, BasicBlock, &basic_block_type, block);
+		_blocks[id] = block;
+		_block_ids[block] = id;
+	}
+	_uses = source._uses;
+	_defs = source._defs;
+	_live_in = source._live_in;
+	_live_out = source._live_out;
+	_live = source._live;
+}
+
+// Iterative DFS over real edges, starting from each block in turn so that
+// unreachable blocks are numbered too.
+void Liveness::compute_post_order(std::vector<uint32_t>& post_order) {
+	using namespace std;
+	vector<bool> visited(_blocks.size(), false);
+	vector<pair<uint32_t, size_t> > stack;
+	for (uint32_t root = 0; root < _blocks.size(); ++root) {
+		if (visited[root]) {
+			continue;
+		}
+		visited[root] = true;
+		stack.push_back(make_pair(root, 0));
+		while (!stack.empty()) {
+			uint32_t id = stack.back().first;
+			size_t& next = stack.back().second;
+			vector<BasicBlock::Edge*>& succs = _blocks[id]->successors();
+			bool descended = false;
+			while (next < succs.size()) {
+				BasicBlock::Edge* edge = succs[next++];
+				long succ = (edge->flags & EDGE_FAKE) ? -1 : block_id(edge->to);
+				if (succ >= 0 && !visited[succ]) {
+					visited[succ] = true;
+					stack.push_back(make_pair((uint32_t)succ, 0));
+					descended = true;
+					break;
+				}
+			}
+			if (!descended) {
+				post_order.push_back(id);
+				stack.pop_back();
+			}
+		}
+	}
+}
+
+void Liveness::solve() {
+	using namespace std;
+	size_t blocks = _blocks.size(), temps = num_temps();
+	vector<uint32_t> post_order;
+	post_order.reserve(blocks);
+	compute_post_order(post_order);
+
+	vector<vector<uint32_t> > preds(blocks), succs(blocks);
+	for (uint32_t id = 0; id < blocks; ++id) {
+		vector<BasicBlock::Edge*>& edges = _blocks[id]->successors();
+		for (vector<BasicBlock::Edge*>::iterator it = edges.begin(); it < edges.end(); ++it) {
+			long succ = ((*it)->flags & EDGE_FAKE) ? -1 : block_id((*it)->to);
+			if (succ >= 0) {
+				succs[id].push_back(succ);
+				preds[succ].push_back(id);
+			}
+		}
+	}
+
+	// LiveIn(B) = Uses(B) | (LiveOut(B) - Defs(B)), LiveOut(B) = U LiveIn(S).
+	// Backward problem, so sweep in post-order until nothing changes.
+	_live_in.assign(blocks, Bitset(temps));
+	_live_out.assign(blocks, Bitset(temps));
+	Bitset scratch(temps);
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (vector<uint32_t>::iterator it = post_order.begin(); it < post_order.end(); ++it) {
+			uint32_t id = *it;
+			Bitset& out = _live_out[id];
+			for (vector<uint32_t>::iterator succ = succs[id].begin(); succ < succs[id].end(); ++succ) {
+				out.union_with(_live_in[*succ]);
+			}
+			scratch = out;
+			scratch.subtract(_defs[id]);
+			scratch.union_with(_uses[id]);
+			changed |= _live_in[id].union_with(scratch);
+		}
+	}
+
+	// Visit(B): temps defined in B, or live into B and flowing from a
+	// predecessor that was visited. Forward, so sweep in reverse post-order.
+	vector<Bitset> visit(blocks, Bitset(temps));
+	changed = true;
+	while (changed) {
+		changed = false;
+		for (vector<uint32_t>::reverse_iterator it = post_order.rbegin(); it < post_order.rend(); ++it) {
+			uint32_t id = *it;
+			scratch.clear();
+			for (vector<uint32_t>::iterator pred = preds[id].begin(); pred < preds[id].end(); ++pred) {
+				scratch.union_with(visit[*pred]);
+			}
+			scratch.intersect_with(_live_in[id]);
+			scratch.union_with(_defs[id]);
+			changed |= visit[id].union_with(scratch);
+		}
+	}
+
+	// Live(B) = LiveIn(B) & Visit(B). The live-out of a visited block is
+	// whatever is Live in its successors.
+	_live.assign(blocks, Bitset(temps));
+	for (uint32_t id = 0; id < blocks; ++id) {
+		_live[id] = _live_in[id];
+		_live[id].intersect_with(visit[id]);
+	}
+	for (uint32_t id = 0; id < blocks; ++id) {
+		Bitset& out = _live_out[id];
+		out.clear();
+		for (vector<uint32_t>::iterator succ = succs[id].begin(); succ < succs[id].end(); ++succ) {
+			out.union_with(_live[*succ]);
+		}
+		out.intersect_with(visit[id]);
+	}
+}
+
+void Liveness::mark() {
+	rb_gc_mark_movable(_temp_ids);
+	rb_gc_mark_movable(_temps);
+	for (std::vector<BasicBlock*>::iterator it = _blocks.begin(); it < _blocks.end(); ++it) {
+		rb_gc_mark_movable((*it)->representation());
+	}
+}
+
+void Liveness::compact() {
+	_temp_ids = rb_gc_location(_temp_ids);
+	_temps = rb_gc_location(_temps);
+}
+
+size_t Liveness::memsize() {
+	using namespace std;
+	size_t size = sizeof(Liveness) + _blocks.capacity() * sizeof(BasicBlock*);
+	size += _block_ids.bucket_count() * sizeof(void*);
+	size += _block_ids.size() * (sizeof(pair<BasicBlock*, uint32_t>) + sizeof(void*));
+	vector<Bitset>* sets[] = { &_uses, &_defs, &_live_in, &_live_out, &_live };
+	for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); ++i) {
+		size += sets[i]->capacity() * sizeof(Bitset);
+		for (vector<Bitset>::iterator it = sets[i]->begin(); it < sets[i]->end(); ++it) {
+			size += it->memsize();
+		}
+	}
+	return size;
+}
+
+extern "C" {
+	static void liveness_mark(void* p) {
+		Liveness *liveness = (Liveness*)p;
+		liveness->mark();
+	}
+
+	static void liveness_free(void* p) {
+		Liveness *liveness = (Liveness*)p;
+		delete liveness;
+	}
+
+	static size_t liveness_memsize(const void* p) {
+		return ((Liveness*)p)->memsize();
+	}
+
+	static void liveness_compact(void* p) {
+		((Liveness*)p)->compact();
+	}
+
+	static const rb_data_type_t liveness_type = {
+		"Laser::Analysis::ControlFlow::Liveness",
+		{ liveness_mark, liveness_free, liveness_memsize, LASER_DCOMPACT(liveness_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE liveness_alloc(VALUE klass) {
+		Liveness *liveness = new Liveness;
+		return TypedData_Wrap_Struct(klass, &liveness_type, liveness);
+	}
+
+	static VALUE liveness_initialize(VALUE self, VALUE blocks, VALUE uses, VALUE definitions) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		blocks = rb_convert_type(blocks, T_ARRAY, "Array", "to_a");
+		uses = rb_convert_type(uses, T_ARRAY, "Array", "to_a");
+		definitions = rb_convert_type(definitions, T_ARRAY, "Array", "to_a");
+		if (RARRAY_LEN(uses) != RARRAY_LEN(blocks) || RARRAY_LEN(definitions) != RARRAY_LEN(blocks)) {
+			rb_raise(rb_eArgError, "Expected uses and definitions for every block.");
+		}
+		liveness->build(blocks, uses, definitions);
+		return Qnil;
+	}
+
+	static VALUE liveness_temps_in(Liveness* liveness, Bitset& set) {
+		VALUE result = rb_ary_new();
+		for (size_t id = set.next(0); id < set.size(); id = set.next(id + 1)) {
+			rb_ary_push(result, liveness->temp(id));
+		}
+		return result;
+	}
+
+	// Looks up the block and temp IDs, returning false if either is unknown.
+	static bool liveness_lookup(VALUE self, VALUE temp, VALUE block, Liveness*& liveness,
+	                            long& temp_id, long& block_id) {
+		BasicBlock *basic_block;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		TypedData_Get_Struct(block, BasicBlock, &basic_block_type, basic_block);
+		temp_id = liveness->temp_id(temp);
+		block_id = liveness->block_id(basic_block);
+		return temp_id >= 0 && block_id >= 0;
+	}
+
+	static long liveness_block_id(Liveness* liveness, VALUE block) {
+		BasicBlock *basic_block;
+		TypedData_Get_Struct(block, BasicBlock, &basic_block_type, basic_block);
+		long id = liveness->block_id(basic_block);
+		if (id < 0) {
+			rb_raise(rb_eArgError, "The given block is not part of this analysis.");
+		}
+		return id;
+	}
+
+	static VALUE liveness_live_p(VALUE self, VALUE temp, VALUE block) {
+		Liveness *liveness;
+		long temp_id, block_id;
+		if (!liveness_lookup(self, temp, block, liveness, temp_id, block_id)) {
+			return Qfalse;
+		}
+		return liveness->live(block_id).test(temp_id) ? Qtrue : Qfalse;
+	}
+
+	static VALUE liveness_live_in_p(VALUE self, VALUE temp, VALUE block) {
+		Liveness *liveness;
+		long temp_id, block_id;
+		if (!liveness_lookup(self, temp, block, liveness, temp_id, block_id)) {
+			return Qfalse;
+		}
+		return liveness->live_in(block_id).test(temp_id) ? Qtrue : Qfalse;
+	}
+
+	static VALUE liveness_live_out_p(VALUE self, VALUE temp, VALUE block) {
+		Liveness *liveness;
+		long temp_id, block_id;
+		if (!liveness_lookup(self, temp, block, liveness, temp_id, block_id)) {
+			return Qfalse;
+		}
+		return liveness->live_out(block_id).test(temp_id) ? Qtrue : Qfalse;
+	}
+
+	static VALUE liveness_live_in(VALUE self, VALUE block) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		return liveness_temps_in(liveness, liveness->live_in(liveness_block_id(liveness, block)));
+	}
+
+	static VALUE liveness_live_out(VALUE self, VALUE block) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		return liveness_temps_in(liveness, liveness->live_out(liveness_block_id(liveness, block)));
+	}
+
+	static VALUE liveness_live(VALUE self, VALUE block) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		return liveness_temps_in(liveness, liveness->live(liveness_block_id(liveness, block)));
+	}
+
+	// Finds every block where the temp's bit is set in the given per-block set.
+	static VALUE liveness_blocks_with(VALUE self, VALUE temp, Bitset& (Liveness::*sets)(size_t)) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		VALUE result = rb_ary_new();
+		long temp_id = liveness->temp_id(temp);
+		if (temp_id < 0) {
+			return result;
+		}
+		for (size_t id = 0; id < liveness->num_blocks(); ++id) {
+			if ((liveness->*sets)(id).test(temp_id)) {
+				rb_ary_push(result, liveness->block(id)->representation());
+			}
+		}
+		return result;
+	}
+
+	static VALUE liveness_live_blocks(VALUE self, VALUE temp) {
+		return liveness_blocks_with(self, temp, &Liveness::live);
+	}
+
+	static VALUE liveness_definition_blocks(VALUE self, VALUE temp) {
+		return liveness_blocks_with(self, temp, &Liveness::definitions);
+	}
+
+	static VALUE liveness_temps(VALUE self) {
+		Liveness *liveness;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		VALUE result = rb_ary_new2(liveness->num_temps());
+		for (size_t id = 0; id < liveness->num_temps(); ++id) {
+			rb_ary_push(result, liveness->temp(id));
+		}
+		return result;
+	}
+
+	static VALUE liveness_translate(VALUE self, VALUE block_lookup, VALUE temp_lookup) {
+		Liveness *liveness, *copy;
+		TypedData_Get_Struct(self, Liveness, &liveness_type, liveness);
+		VALUE result = liveness_alloc(rb_cLiveness);
+		TypedData_Get_Struct(result, Liveness, &liveness_type, copy);
+		copy->translate(*liveness, block_lookup, temp_lookup);
+		return result;
+	}
+
+	void Init_Liveness() {
+		rb_cLiveness = rb_define_class_under(rb_mControlFlow, "Liveness", rb_cObject);
+		rb_define_alloc_func(rb_cLiveness, liveness_alloc);
+		rb_define_method(rb_cLiveness, "initialize", RUBY_METHOD_FUNC(liveness_initialize), 3);
+		rb_define_method(rb_cLiveness, "translate", RUBY_METHOD_FUNC(liveness_translate), 2);
+		rb_define_method(rb_cLiveness, "temps", RUBY_METHOD_FUNC(liveness_temps), 0);
+		rb_define_method(rb_cLiveness, "live?", RUBY_METHOD_FUNC(liveness_live_p), 2);
+		rb_define_method(rb_cLiveness, "live_in?", RUBY_METHOD_FUNC(liveness_live_in_p), 2);
+		rb_define_method(rb_cLiveness, "live_out?", RUBY_METHOD_FUNC(liveness_live_out_p), 2);
+		rb_define_method(rb_cLiveness, "live", RUBY_METHOD_FUNC(liveness_live), 1);
+		rb_define_method(rb_cLiveness, "live_in", RUBY_METHOD_FUNC(liveness_live_in), 1);
+		rb_define_method(rb_cLiveness, "live_out", RUBY_METHOD_FUNC(liveness_live_out), 1);
+		rb_define_method(rb_cLiveness, "live_blocks", RUBY_METHOD_FUNC(liveness_live_blocks), 1);
+		rb_define_method(rb_cLiveness, "definition_blocks", RUBY_METHOD_FUNC(liveness_definition_blocks), 1);
+	}
+}
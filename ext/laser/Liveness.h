@@ -0,0 +1,67 @@
+#ifndef LASER_LIVENESS_H_
+#define LASER_LIVENESS_H_
+
+#include <vector>
+#include <unordered_map>
+#include "BasicBlock.h"
+#include "Bitset.h"
+#include "ruby.h"
+
+namespace Laser {
+	// Bitset-based liveness over the real (non-fake) edges of a CFG. Blocks
+	// and temps get dense integer IDs; each block carries bitsets over temps.
+	//
+	// Live(T) follows Morgan: the blocks where T is live on entry, restricted
+	// to those reachable from a definition of T through such blocks.
+	class Liveness {
+	  public:
+		Liveness() : _temp_ids(Qnil), _temps(Qnil) {}
+
+		// Takes parallel arrays of blocks, the upward-exposed uses of each
+		// block, and the temps each block defines, then solves for liveness.
+		void build(VALUE blocks, VALUE uses, VALUE definitions);
+		// Copies the solved sets onto the blocks and temps of a duplicated
+		// graph. Temps are mapped by a Hash; blocks by a Hash, or by an Array
+		// indexed by block ID as returned by ControlFlowGraph#copy_topology.
+		void translate(Liveness& source, VALUE block_lookup, VALUE temp_lookup);
+
+		// Returns the dense ID of the temp, or -1 if it is never used.
+		long temp_id(VALUE temp);
+		// Returns the dense ID of the block, or -1 if it isn't in the graph.
+		long block_id(BasicBlock* block);
+
+		inline size_t num_blocks() { return _blocks.size(); }
+		inline size_t num_temps() { return (_temps == Qnil) ? 0 : RARRAY_LEN(_temps); }
+		inline BasicBlock* block(size_t id) { return _blocks[id]; }
+		inline VALUE temp(size_t id) { return rb_ary_entry(_temps, id); }
+		inline Bitset& live_in(size_t block) { return _live_in[block]; }
+		inline Bitset& live_out(size_t block) { return _live_out[block]; }
+		inline Bitset& live(size_t block) { return _live[block]; }
+		inline Bitset& definitions(size_t block) { return _defs[block]; }
+
+		void mark();
+		void compact();
+		size_t memsize();
+
+	  private:
+		long intern_temp(VALUE temp);
+		void compute_post_order(std::vector<uint32_t>& post_order);
+		void solve();
+
+		VALUE _temp_ids;
+		VALUE _temps;
+		std::vector<BasicBlock*> _blocks;
+		std::unordered_map<BasicBlock*, uint32_t> _block_ids;
+		// Per block, over temp IDs.
+		std::vector<Bitset> _uses;
+		std::vector<Bitset> _defs;
+		std::vector<Bitset> _live_in;
+		std::vector<Bitset> _live_out;
+		std::vector<Bitset> _live;
+	};
+}
+extern "C" {
+	void Init_Liveness();
+}
+
+#endif
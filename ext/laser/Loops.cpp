@@ -0,0 +1,248 @@
+#include "Loops.h"
+#include "Dominators.h"
+#include "ControlFlowGraph.h"
+#include <algorithm>
+#include "ruby.h"
+
+using namespace Laser;
+
+const uint32_t LoopForest::NONE;
+
+// Headers are taken in post-order, so each inner loop is found before the
+// loops around it: walking back from the latches of an outer loop, a block
+// already in a loop stands for the outermost loop found around it so far,
+// which becomes a child of the new loop, and the walk goes on from that
+// loop's header. Every block the walk reaches is dominated by the header.
+void LoopForest::refresh() {
+	using namespace std;
+	if (_valid && _generation == _graph->edge_generation()) {
+		return;
+	}
+	_headers.clear();
+	_parents.clear();
+	_depths.clear();
+	_back_edges.clear();
+	_order.clear();
+	_loops.assign(_graph->id_limit(), NONE);
+	_priorities.assign(_graph->id_limit(), NONE);
+	_generation = _graph->edge_generation();
+	_valid = true;
+	BasicBlock* entry = _graph->entry();
+	if (!entry || !_graph->has_vertex(entry)) {
+		return;
+	}
+	compute_dominators(entry);
+	vector<BasicBlock*>& post_order = _graph->post_order();
+	vector<BasicBlock*> worklist;
+	for (vector<BasicBlock*>::iterator it = post_order.begin(); it < post_order.end(); ++it) {
+		BasicBlock* header = *it;
+		uint32_t number = _headers.size();
+		vector<BasicBlock::Edge*>& preds = header->predecessors();
+		for (vector<BasicBlock::Edge*>::iterator edge = preds.begin(); edge < preds.end(); ++edge) {
+			if (((*edge)->flags & EDGE_FAKE) == 0 && _graph->reachable((*edge)->from) &&
+			    header->dominates((*edge)->from)) {
+				_back_edges.push_back(*edge);
+				worklist.push_back((*edge)->from);
+			}
+		}
+		if (worklist.empty()) {
+			continue;
+		}
+		_headers.push_back(header);
+		_parents.push_back(NONE);
+		_loops[header->id()] = number;
+		while (!worklist.empty()) {
+			BasicBlock* block = worklist.back();
+			worklist.pop_back();
+			uint32_t inner = _loops[block->id()];
+			if (inner == NONE) {
+				_loops[block->id()] = number;
+			} else {
+				while (_parents[inner] != NONE) {
+					inner = _parents[inner];
+				}
+				if (inner == number) {
+					continue;
+				}
+				_parents[inner] = number;
+				block = _headers[inner];
+			}
+			vector<BasicBlock::Edge*>& block_preds = block->predecessors();
+			for (vector<BasicBlock::Edge*>::iterator edge = block_preds.begin(); edge < block_preds.end(); ++edge) {
+				if (((*edge)->flags & EDGE_FAKE) == 0 && _graph->reachable((*edge)->from)) {
+					worklist.push_back((*edge)->from);
+				}
+			}
+		}
+	}
+
+	// Outer loops were numbered after the loops inside them.
+	_depths.resize(_headers.size());
+	for (uint32_t number = _headers.size(); number-- > 0; ) {
+		_depths[number] = (_parents[number] == NONE) ? 1 : _depths[_parents[number]] + 1;
+	}
+
+	// Orders the blocks by the reverse post-order numbers of their loops'
+	// headers, outermost first, and then by their own.
+	size_t size = post_order.size();
+	vector<pair<vector<uint32_t>, BasicBlock*> > keys(size);
+	for (size_t i = 0; i < size; ++i) {
+		BasicBlock* block = post_order[i];
+		vector<uint32_t>& key = keys[i].first;
+		key.push_back(size - 1 - i);
+		for (uint32_t number = _loops[block->id()]; number != NONE; number = _parents[number]) {
+			key.push_back(size - 1 - _headers[number]->post_order_number());
+		}
+		reverse(key.begin(), key.end());
+		keys[i].second = block;
+	}
+	sort(keys.begin(), keys.end());
+	_order.resize(size);
+	for (size_t i = 0; i < size; ++i) {
+		_order[i] = keys[i].second;
+		_priorities[keys[i].second->id()] = i;
+	}
+}
+
+uint32_t LoopForest::loop(BasicBlock* block) {
+	refresh();
+	if (!_graph->has_vertex(block) || block->id() >= _loops.size()) {
+		return NONE;
+	}
+	return _loops[block->id()];
+}
+
+BasicBlock* LoopForest::header(BasicBlock* block) {
+	uint32_t number = loop(block);
+	return (number == NONE) ? NULL : _headers[number];
+}
+
+BasicBlock* LoopForest::outer_header(BasicBlock* header) {
+	uint32_t number = loop(header);
+	if (number == NONE || _headers[number] != header || _parents[number] == NONE) {
+		return NULL;
+	}
+	return _headers[_parents[number]];
+}
+
+uint32_t LoopForest::depth(BasicBlock* block) {
+	uint32_t number = loop(block);
+	return (number == NONE) ? 0 : _depths[number];
+}
+
+bool LoopForest::is_back_edge(BasicBlock* from, BasicBlock* to) {
+	uint32_t number = loop(to);
+	if (number == NONE || _headers[number] != to) {
+		return false;
+	}
+	std::vector<BasicBlock::Edge*>& preds = to->predecessors();
+	for (std::vector<BasicBlock::Edge*>::iterator edge = preds.begin(); edge < preds.end(); ++edge) {
+		if ((*edge)->from == from) {
+			return std::find(_back_edges.begin(), _back_edges.end(), *edge) != _back_edges.end();
+		}
+	}
+	return false;
+}
+
+uint32_t LoopForest::priority(BasicBlock* block) {
+	refresh();
+	if (!_graph->has_vertex(block) || block->id() >= _priorities.size()) {
+		return NONE;
+	}
+	return _priorities[block->id()];
+}
+
+size_t LoopForest::memsize() {
+	return sizeof(LoopForest) + (_headers.capacity() + _back_edges.capacity() + _order.capacity()) * sizeof(void*) +
+	       (_parents.capacity() + _depths.capacity() + _loops.capacity() + _priorities.capacity()) *
+	       sizeof(uint32_t);
+}
+
+extern "C" {
+	static LoopForest* loops_of(BasicBlock* block) {
+		ControlFlowGraph* graph = block->graph();
+		return (graph && graph->has_vertex(block)) ? &graph->loops() : NULL;
+	}
+
+	static VALUE bb_loop_header(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		LoopForest* loops = loops_of(block);
+		BasicBlock* header = loops ? loops->header(block) : NULL;
+		return header ? header->representation() : Qnil;
+	}
+
+	static VALUE bb_outer_loop_header(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		LoopForest* loops = loops_of(block);
+		BasicBlock* header = loops ? loops->outer_header(block) : NULL;
+		return header ? header->representation() : Qnil;
+	}
+
+	static VALUE bb_loop_header_p(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		LoopForest* loops = loops_of(block);
+		return (loops && loops->header(block) == block) ? Qtrue : Qfalse;
+	}
+
+	static VALUE bb_loop_depth(VALUE self) {
+		BasicBlock *block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		LoopForest* loops = loops_of(block);
+		return UINT2NUM(loops ? loops->depth(block) : 0);
+	}
+
+	static VALUE bb_is_back_edge(VALUE self, VALUE other) {
+		BasicBlock *block, *other_block;
+		TypedData_Get_Struct(self, BasicBlock, &basic_block_type, block);
+		TypedData_Get_Struct(other, BasicBlock, &basic_block_type, other_block);
+		LoopForest* loops = loops_of(block);
+		return (loops && loops->is_back_edge(block, other_block)) ? Qtrue : Qfalse;
+	}
+
+	static VALUE cfg_loop_headers(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		std::vector<BasicBlock*>& headers = graph->loops().headers();
+		VALUE result = rb_ary_new2(headers.size());
+		for (std::vector<BasicBlock*>::iterator it = headers.begin(); it < headers.end(); ++it) {
+			rb_ary_push(result, (*it)->representation());
+		}
+		return result;
+	}
+
+	static VALUE cfg_back_edges(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		std::vector<BasicBlock::Edge*>& edges = graph->loops().back_edges();
+		VALUE result = rb_ary_new2(edges.size());
+		for (std::vector<BasicBlock::Edge*>::iterator it = edges.begin(); it < edges.end(); ++it) {
+			rb_ary_push(result, rb_assoc_new((*it)->from->representation(), (*it)->to->representation()));
+		}
+		return result;
+	}
+
+	static VALUE cfg_loop_order(VALUE self) {
+		ControlFlowGraph *graph;
+		TypedData_Get_Struct(self, ControlFlowGraph, &control_flow_graph_type, graph);
+		std::vector<BasicBlock*>& order = graph->loops().order();
+		VALUE result = rb_ary_new2(order.size());
+		for (std::vector<BasicBlock*>::iterator it = order.begin(); it < order.end(); ++it) {
+			rb_ary_push(result, (*it)->representation());
+		}
+		return result;
+	}
+
+	void Init_Loops() {
+		rb_define_method(rb_cBasicBlock, "loop_header", RUBY_METHOD_FUNC(bb_loop_header), 0);
+		rb_define_method(rb_cBasicBlock, "outer_loop_header", RUBY_METHOD_FUNC(bb_outer_loop_header), 0);
+		rb_define_method(rb_cBasicBlock, "loop_header?", RUBY_METHOD_FUNC(bb_loop_header_p), 0);
+		rb_define_method(rb_cBasicBlock, "loop_depth", RUBY_METHOD_FUNC(bb_loop_depth), 0);
+		rb_define_method(rb_cBasicBlock, "is_back_edge?", RUBY_METHOD_FUNC(bb_is_back_edge), 1);
+		rb_define_method(rb_cControlFlowGraph, "loop_headers", RUBY_METHOD_FUNC(cfg_loop_headers), 0);
+		rb_define_method(rb_cControlFlowGraph, "back_edges", RUBY_METHOD_FUNC(cfg_back_edges), 0);
+		rb_define_method(rb_cControlFlowGraph, "loop_order", RUBY_METHOD_FUNC(cfg_loop_order), 0);
+	}
+}
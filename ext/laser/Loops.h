@@ -0,0 +1,84 @@
+#ifndef LASER_LOOPS_H_
+#define LASER_LOOPS_H_
+
+#include <stdint.h>
+#include <vector>
+#include "BasicBlock.h"
+#include "ruby.h"
+
+namespace Laser {
+	class ControlFlowGraph;
+	// The loop nesting forest of a graph: its natural loops over real
+	// edges, found from the dominator tree rooted at the entry. A back edge
+	// is a real edge whose destination dominates its source, and the loop
+	// of a header holds every block that reaches one of the header's back
+	// edges without passing through the header. Cycles that can be entered
+	// at more than one block (irreducible ones) have no such header, so
+	// they are not loops here.
+	//
+	// The forest also orders the reachable blocks for worklists: reverse
+	// post-order, except that each loop's blocks directly follow its
+	// header (a weak topological order, after Bourdoncle). A worklist keyed
+	// by it settles an inner loop before moving on past it.
+	//
+	// The graph owns its forest and rebuilds it on the first query after
+	// its real edges change.
+	class LoopForest {
+	  public:
+		static const uint32_t NONE = UINT32_MAX;
+
+		explicit LoopForest(ControlFlowGraph* graph) : _graph(graph), _generation(0), _valid(false) {}
+
+		// The header of the innermost loop holding the block, which is the
+		// block itself for a header, or NULL outside every loop.
+		BasicBlock* header(BasicBlock* block);
+		// The header of the loop enclosing the header's own loop, or NULL.
+		BasicBlock* outer_header(BasicBlock* header);
+		// The number of loops holding the block.
+		uint32_t depth(BasicBlock* block);
+		bool is_back_edge(BasicBlock* from, BasicBlock* to);
+		// The block's position in the worklist order, or NONE if it is
+		// unreachable from the entry.
+		uint32_t priority(BasicBlock* block);
+
+		// Innermost loops first.
+		inline std::vector<BasicBlock*>& headers() {
+			refresh();
+			return _headers;
+		}
+		inline std::vector<BasicBlock::Edge*>& back_edges() {
+			refresh();
+			return _back_edges;
+		}
+		// The reachable blocks in the worklist order.
+		inline std::vector<BasicBlock*>& order() {
+			refresh();
+			return _order;
+		}
+
+		size_t memsize();
+
+	  private:
+		void refresh();
+		uint32_t loop(BasicBlock* block);
+
+		ControlFlowGraph* _graph;
+		// The graph's edge generation the forest was built at.
+		uint64_t _generation;
+		bool _valid;
+		// By loop number.
+		std::vector<BasicBlock*> _headers;
+		std::vector<uint32_t> _parents;
+		std::vector<uint32_t> _depths;
+		std::vector<BasicBlock::Edge*> _back_edges;
+		std::vector<BasicBlock*> _order;
+		// By block ID: the innermost loop's number, and the worklist order.
+		std::vector<uint32_t> _loops;
+		std::vector<uint32_t> _priorities;
+	};
+}
+extern "C" {
+	void Init_Loops();
+}
+
+#endif
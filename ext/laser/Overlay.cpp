@@ -0,0 +1,188 @@
+#include "Overlay.h"
+#include "ControlFlowGraph.h"
+#include "ruby.h"
+
+VALUE rb_cOverlay;
+
+using namespace Laser;
+
+Overlay::~Overlay() {
+	if (!_graph) {
+		return;
+	}
+	if (_entered) {
+		_graph->set_overlay(NULL);
+	}
+	_graph->release();
+}
+
+void Overlay::attach(ControlFlowGraph* graph) {
+	graph->retain();
+	_graph = graph;
+	_stamp = graph->edge_removals();
+}
+
+bool Overlay::stale() {
+	return !_entered && !_flags.empty() && _stamp != _graph->edge_removals();
+}
+
+size_t Overlay::size() {
+	return _entered ? _base.size() : _flags.size();
+}
+
+void Overlay::enter() {
+	_entered = true;
+	_graph->set_overlay(this);
+	for (std::unordered_map<BasicBlock::Edge*, uint8_t>::iterator it = _flags.begin(); it != _flags.end(); ++it) {
+		BasicBlock::Edge* edge = it->first;
+		record(edge);
+		if (edge->flags != it->second) {
+			edge->from->change_flags(*edge, it->second);
+		}
+	}
+}
+
+// The graph's flags go back through change_flags, so its caches and
+// dominator tree follow them, once the overlay no longer records changes.
+void Overlay::leave() {
+	_flags.clear();
+	for (std::unordered_map<BasicBlock::Edge*, uint8_t>::iterator it = _base.begin(); it != _base.end(); ++it) {
+		_flags[it->first] = it->first->flags;
+	}
+	_graph->set_overlay(NULL);
+	for (std::unordered_map<BasicBlock::Edge*, uint8_t>::iterator it = _base.begin(); it != _base.end(); ++it) {
+		BasicBlock::Edge* edge = it->first;
+		if (edge->flags != it->second) {
+			edge->from->change_flags(*edge, it->second);
+		}
+	}
+	_base.clear();
+	_entered = false;
+	_stamp = _graph->edge_removals();
+}
+
+void Overlay::forget(BasicBlock::Edge* edge) {
+	_base.erase(edge);
+	_flags.erase(edge);
+}
+
+void Overlay::mark() {
+	if (_graph) {
+		rb_gc_mark_movable(_graph->representation());
+	}
+}
+
+void Overlay::compact() {
+	_representation = rb_gc_location(_representation);
+}
+
+size_t Overlay::memsize() {
+	// Each map entry is a node holding the pair, plus a bucket pointer.
+	size_t entry = sizeof(std::pair<BasicBlock::Edge*, uint8_t>) + 2 * sizeof(void*);
+	return sizeof(Overlay) + (_flags.size() + _base.size()) * entry +
+	       (_flags.bucket_count() + _base.bucket_count()) * sizeof(void*);
+}
+
+extern "C" {
+	static void overlay_mark(void* p) {
+		((Overlay*)p)->mark();
+	}
+
+	static void overlay_free(void* p) {
+		delete (Overlay*)p;
+	}
+
+	static size_t overlay_memsize(const void* p) {
+		return ((Overlay*)p)->memsize();
+	}
+
+	static void overlay_compact(void* p) {
+		((Overlay*)p)->compact();
+	}
+
+	static const rb_data_type_t overlay_type = {
+		"Laser::Analysis::ControlFlow::Overlay",
+		{ overlay_mark, overlay_free, overlay_memsize, LASER_DCOMPACT(overlay_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE overlay_alloc(VALUE klass) {
+		Overlay *overlay = new Overlay;
+		VALUE result = TypedData_Wrap_Struct(klass, &overlay_type, overlay);
+		overlay->set_representation(result);
+		return result;
+	}
+
+	static Overlay* overlay_attached(VALUE self) {
+		Overlay *overlay;
+		TypedData_Get_Struct(self, Overlay, &overlay_type, overlay);
+		if (!overlay->graph()) {
+			rb_raise(rb_eRuntimeError, "The overlay has no graph.");
+		}
+		return overlay;
+	}
+
+	static VALUE overlay_initialize(VALUE self, VALUE graph) {
+		Overlay *overlay;
+		ControlFlowGraph *base;
+		TypedData_Get_Struct(self, Overlay, &overlay_type, overlay);
+		TypedData_Get_Struct(graph, ControlFlowGraph, &control_flow_graph_type, base);
+		if (overlay->graph()) {
+			rb_raise(rb_eRuntimeError, "The overlay already has a graph.");
+		}
+		overlay->attach(base);
+		return Qnil;
+	}
+
+	static VALUE overlay_graph(VALUE self) {
+		return overlay_attached(self)->graph()->representation();
+	}
+
+	static VALUE overlay_enter(VALUE self) {
+		Overlay *overlay = overlay_attached(self);
+		if (overlay->entered()) {
+			rb_raise(rb_eRuntimeError, "The overlay is already entered.");
+		}
+		if (overlay->graph()->overlay()) {
+			rb_raise(rb_eRuntimeError, "Another overlay of the graph is entered.");
+		}
+		if (overlay->stale()) {
+			rb_raise(rb_eRuntimeError, "An edge of the graph was removed since the overlay left it.");
+		}
+		overlay->enter();
+		return self;
+	}
+
+	static VALUE overlay_leave(VALUE self) {
+		Overlay *overlay = overlay_attached(self);
+		if (!overlay->entered()) {
+			rb_raise(rb_eRuntimeError, "The overlay is not entered.");
+		}
+		overlay->leave();
+		return self;
+	}
+
+	static VALUE overlay_entered_p(VALUE self) {
+		return overlay_attached(self)->entered() ? Qtrue : Qfalse;
+	}
+
+	static VALUE overlay_stale_p(VALUE self) {
+		return overlay_attached(self)->stale() ? Qtrue : Qfalse;
+	}
+
+	static VALUE overlay_size(VALUE self) {
+		return SIZET2NUM(overlay_attached(self)->size());
+	}
+
+	void Init_Overlay() {
+		rb_cOverlay = rb_define_class_under(rb_mControlFlow, "Overlay", rb_cObject);
+		rb_define_alloc_func(rb_cOverlay, overlay_alloc);
+		rb_define_method(rb_cOverlay, "initialize", RUBY_METHOD_FUNC(overlay_initialize), 1);
+		rb_define_method(rb_cOverlay, "graph", RUBY_METHOD_FUNC(overlay_graph), 0);
+		rb_define_method(rb_cOverlay, "enter", RUBY_METHOD_FUNC(overlay_enter), 0);
+		rb_define_method(rb_cOverlay, "leave", RUBY_METHOD_FUNC(overlay_leave), 0);
+		rb_define_method(rb_cOverlay, "entered?", RUBY_METHOD_FUNC(overlay_entered_p), 0);
+		rb_define_method(rb_cOverlay, "stale?", RUBY_METHOD_FUNC(overlay_stale_p), 0);
+		rb_define_method(rb_cOverlay, "size", RUBY_METHOD_FUNC(overlay_size), 0);
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef LASER_OVERLAY_H_
+#define LASER_OVERLAY_H_
+
+#include <unordered_map>
+#include "BasicBlock.h"
+#include "ruby.h"
+
+namespace Laser {
+	class ControlFlowGraph;
+	// A what-if layer over the edge flags of a graph, so constant
+	// propagation can run under other assumptions without copying the
+	// graph. The overlay shares the graph's blocks, edges and instructions,
+	// and keeps only the flags it gave the edges it changed.
+	//
+	// While entered, the overlay's flags are on the edges themselves, so
+	// every query sees them, and the graph's own flags for the edges changed
+	// since entering are set aside; leaving puts them back. A graph has at
+	// most one overlay entered at a time, but any number can take turns.
+	// Removing an edge from the graph makes its other overlays stale.
+	class Overlay {
+	  public:
+		Overlay() : _graph(NULL), _representation(Qnil), _entered(false), _stamp(0) {}
+		~Overlay();
+		void attach(ControlFlowGraph* graph);
+
+		// Puts the overlay's flags on the edges. The graph must have no
+		// overlay entered, and this one must not be stale.
+		void enter();
+		// Takes the overlay's flags off the edges, restoring the graph's.
+		void leave();
+		inline bool entered() { return _entered; }
+		bool stale();
+		// The number of edges whose flags the overlay changed.
+		size_t size();
+
+		// Called before the flags of an edge of the graph change while the
+		// overlay is entered, and before an edge of the graph is freed.
+		inline void record(BasicBlock::Edge* edge) { _base.insert(std::make_pair(edge, edge->flags)); }
+		void forget(BasicBlock::Edge* edge);
+
+		inline ControlFlowGraph* graph() { return _graph; }
+		inline VALUE representation() { return _representation; }
+		inline void set_representation(VALUE representation) { _representation = representation; }
+
+		void mark();
+		void compact();
+		size_t memsize();
+
+	  private:
+		ControlFlowGraph* _graph;
+		VALUE _representation;
+		bool _entered;
+		// The graph's edge removal count as of the last leave.
+		uint64_t _stamp;
+		// The overlay's flags for the edges it changed, as of the last leave.
+		std::unordered_map<BasicBlock::Edge*, uint8_t> _flags;
+		// While entered, the graph's flags for the edges changed since.
+		std::unordered_map<BasicBlock::Edge*, uint8_t> _base;
+	};
+}
+extern VALUE rb_cOverlay;
+extern "C" {
+	void Init_Overlay();
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "Precompute.h"
+#include "Dominators.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <system_error>
+#include <thread>
+#include "ruby.h"
+#ifdef HAVE_RUBY_THREAD_H
+#include "ruby/thread.h"
+#endif
+
+using namespace Laser;
+
+namespace {
+	// A batch of independent tasks. Threads take the next unstarted task
+	// from a shared counter, so a thread stuck on one large graph doesn't
+	// hold up the rest of the batch.
+	struct PrecomputeBatch {
+		PrecomputeBatch(size_t count, size_t threads, void (*task)(void*, size_t), void* data)
+		    : count(count), threads(threads), task(task), data(data), next(0), failed(false) {}
+		size_t count;
+		size_t threads;
+		void (*task)(void*, size_t);
+		void* data;
+		std::atomic<size_t> next;
+		std::atomic<bool> failed;
+	};
+}
+
+static void precompute_work(PrecomputeBatch* batch) {
+	for (size_t i = batch->next++; i < batch->count; i = batch->next++) {
+		try {
+			batch->task(batch->data, i);
+		} catch (std::bad_alloc& e) {
+			batch->failed = true;
+		}
+	}
+}
+
+static void* precompute_run(void* data) {
+	PrecomputeBatch* batch = static_cast<PrecomputeBatch*>(data);
+	std::vector<std::thread> workers;
+	size_t threads = std::min(batch->threads, batch->count);
+	for (size_t i = 1; i < threads; ++i) {
+		try {
+			workers.push_back(std::thread(precompute_work, batch));
+		} catch (std::system_error& e) {
+			// Fewer threads just means each one takes more tasks.
+			break;
+		}
+	}
+	precompute_work(batch);
+	for (std::vector<std::thread>::iterator it = workers.begin(); it < workers.end(); ++it) {
+		it->join();
+	}
+	return NULL;
+}
+
+// Runs the tasks to completion, without the GVL where Ruby allows it.
+static bool precompute_parallel(size_t count, size_t threads, void (*task)(void*, size_t), void* data) {
+	PrecomputeBatch batch(count, threads, task, data);
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+	rb_thread_call_without_gvl(precompute_run, &batch, NULL, NULL);
+#else
+	precompute_run(&batch);
+#endif
+	return !batch.failed;
+}
+
+static void solve_snapshot(void* snapshots, size_t i) {
+	DominatorSnapshot& snapshot = (*static_cast<std::vector<DominatorSnapshot>*>(snapshots))[i];
+	snapshot.solve();
+	snapshot.solve_frontiers();
+}
+
+bool Laser::precompute_all(std::vector<ControlFlowGraph*>& graphs, size_t threads) {
+	using namespace std;
+	// Solving one graph from two threads at once would race.
+	sort(graphs.begin(), graphs.end());
+	graphs.erase(unique(graphs.begin(), graphs.end()), graphs.end());
+
+	// Only the snapshots are touched without the GVL. The blocks are read
+	// and written under it, and a graph that another thread edited in the
+	// meantime keeps what it has: its blocks may no longer be its own.
+	vector<DominatorSnapshot> snapshots;
+	vector<pair<ControlFlowGraph*, uint64_t> > captured;
+	for (vector<ControlFlowGraph*>::iterator it = graphs.begin(); it < graphs.end(); ++it) {
+		BasicBlock* entry = (*it)->entry();
+		if (!entry) {
+			continue;
+		}
+		if (!(*it)->dominators_valid() || entry->dominator_root() != entry || !entry->frontiers_current()) {
+			snapshots.push_back(DominatorSnapshot(entry));
+			captured.push_back(make_pair(*it, (*it)->edge_generation()));
+		}
+	}
+	if (!precompute_parallel(snapshots.size(), threads, solve_snapshot, &snapshots)) {
+		return false;
+	}
+	for (size_t i = 0; i < snapshots.size(); ++i) {
+		if (captured[i].first->edge_generation() == captured[i].second) {
+			snapshots[i].attach();
+		}
+	}
+	return true;
+}
+
+extern "C" {
+	static bool precompute_graphs(VALUE graphs, size_t threads) {
+		std::vector<ControlFlowGraph*> list;
+		for (long i = 0; i < RARRAY_LEN(graphs); ++i) {
+			ControlFlowGraph *graph;
+			TypedData_Get_Struct(rb_ary_entry(graphs, i), ControlFlowGraph, &control_flow_graph_type, graph);
+			list.push_back(graph);
+		}
+		return precompute_all(list, threads);
+	}
+
+	// ControlFlow.precompute_all(graphs, threads = nil) computes the
+	// traversal, dominators, and dominance frontiers of many graphs at once,
+	// using one thread per core unless told otherwise. Returns the graphs.
+	static VALUE cf_precompute_all(int argc, VALUE* argv, VALUE self) {
+		VALUE graphs, threads;
+		rb_scan_args(argc, argv, "11", &graphs, &threads);
+		graphs = rb_convert_type(graphs, T_ARRAY, "Array", "to_a");
+		for (long i = 0; i < RARRAY_LEN(graphs); ++i) {
+			if (!rb_obj_is_kind_of(rb_ary_entry(graphs, i), rb_cControlFlowGraph)) {
+				rb_raise(rb_eTypeError, "Expected a ControlFlowGraph, got %" PRIsVALUE ".",
+				         rb_obj_class(rb_ary_entry(graphs, i)));
+			}
+		}
+		size_t num_threads = NIL_P(threads) ? std::thread::hardware_concurrency() : NUM2ULONG(threads);
+		if (!precompute_graphs(graphs, std::max(num_threads, (size_t)1))) {
+			rb_memerror();
+		}
+		RB_GC_GUARD(graphs);
+		return graphs;
+	}
+
+	void Init_Precompute() {
+		rb_define_singleton_method(rb_mControlFlow, "precompute_all", RUBY_METHOD_FUNC(cf_precompute_all), -1);
+	}
+}
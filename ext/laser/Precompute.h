@@ -0,0 +1,21 @@
+#ifndef LASER_PRECOMPUTE_H_
+#define LASER_PRECOMPUTE_H_
+
+#include <vector>
+#include "ControlFlowGraph.h"
+
+namespace Laser {
+	// Computes the traversal, dominator tree, and dominance frontiers of each
+	// graph, so later passes find them cached. The traversals are taken and
+	// the results attached with the GVL held; the dominator trees and the
+	// frontiers are solved from the copied topology without it, on up to
+	// the given number of threads. A graph edited by another thread in the
+	// meantime is left to compute its own on demand.
+	// Returns false if a thread ran out of memory.
+	bool precompute_all(std::vector<ControlFlowGraph*>& graphs, size_t threads);
+}
+extern "C" {
+	void Init_Precompute();
+}
+
+#endif
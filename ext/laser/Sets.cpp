@@ -0,0 +1,525 @@
+#include "Sets.h"
+#include "ControlFlowGraph.h"
+#include "ruby.h"
+
+VALUE rb_cBlockSet;
+VALUE rb_cTempSet;
+
+using namespace Laser;
+
+BlockSet::~BlockSet() {
+	if (_graph) {
+		_graph->release();
+	}
+}
+
+void BlockSet::attach(ControlFlowGraph* graph) {
+	graph->retain();
+	_graph = graph;
+}
+
+long BlockSet::find(BasicBlock* block) {
+	return _graph->has_vertex(block) ? (long)block->id() : -1;
+}
+
+Bitset& BlockSet::bits() {
+	_bits.grow(_graph->id_limit());
+	return _bits;
+}
+
+void BlockSet::mark() {
+	if (_graph) {
+		rb_gc_mark_movable(_graph->representation());
+	}
+}
+
+size_t BlockSet::memsize() {
+	return sizeof(BlockSet) + _bits.memsize();
+}
+
+void TempSet::create_universe() {
+	_ids = rb_hash_new();
+	rb_funcall(_ids, rb_intern("compare_by_identity"), 0);
+	_temps = rb_ary_new();
+}
+
+void TempSet::share_universe(TempSet& other) {
+	_ids = other._ids;
+	_temps = other._temps;
+}
+
+long TempSet::find(VALUE temp) {
+	VALUE id = rb_hash_lookup2(_ids, temp, Qnil);
+	return NIL_P(id) ? -1 : FIX2LONG(id);
+}
+
+size_t TempSet::intern(VALUE temp) {
+	long id = find(temp);
+	if (id >= 0) {
+		return id;
+	}
+	id = RARRAY_LEN(_temps);
+	rb_hash_aset(_ids, temp, LONG2FIX(id));
+	rb_ary_push(_temps, temp);
+	return id;
+}
+
+Bitset& TempSet::bits() {
+	_bits.grow(RARRAY_LEN(_temps));
+	return _bits;
+}
+
+void TempSet::mark() {
+	rb_gc_mark_movable(_ids);
+	rb_gc_mark_movable(_temps);
+}
+
+void TempSet::compact() {
+	_ids = rb_gc_location(_ids);
+	_temps = rb_gc_location(_temps);
+}
+
+// The universe is a Hash and an Array, which Ruby reports itself.
+size_t TempSet::memsize() {
+	return sizeof(TempSet) + _bits.memsize();
+}
+
+extern "C" {
+	static void block_set_mark(void* p) {
+		((BlockSet*)p)->mark();
+	}
+
+	static void block_set_free(void* p) {
+		delete (BlockSet*)p;
+	}
+
+	static size_t block_set_memsize(const void* p) {
+		return ((BlockSet*)p)->memsize();
+	}
+
+	static const rb_data_type_t block_set_type = {
+		"Laser::Analysis::ControlFlow::BlockSet",
+		{ block_set_mark, block_set_free, block_set_memsize, },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE block_set_alloc(VALUE klass) {
+		return TypedData_Wrap_Struct(klass, &block_set_type, new BlockSet);
+	}
+
+	static void temp_set_mark(void* p) {
+		((TempSet*)p)->mark();
+	}
+
+	static void temp_set_free(void* p) {
+		delete (TempSet*)p;
+	}
+
+	static size_t temp_set_memsize(const void* p) {
+		return ((TempSet*)p)->memsize();
+	}
+
+	static void temp_set_compact(void* p) {
+		((TempSet*)p)->compact();
+	}
+
+	static const rb_data_type_t temp_set_type = {
+		"Laser::Analysis::ControlFlow::TempSet",
+		{ temp_set_mark, temp_set_free, temp_set_memsize, LASER_DCOMPACT(temp_set_compact), },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE temp_set_alloc(VALUE klass) {
+		return TypedData_Wrap_Struct(klass, &temp_set_type, new TempSet);
+	}
+}
+
+// How each kind of set maps its elements to IDs. Sets are compatible when
+// the same IDs mean the same elements, so their bits can be combined.
+struct BlockSetTraits {
+	typedef BlockSet Set;
+	static const rb_data_type_t* type() { return &block_set_type; }
+	static Set* get(VALUE self) {
+		BlockSet *set;
+		TypedData_Get_Struct(self, BlockSet, &block_set_type, set);
+		if (!set->graph()) {
+			rb_raise(rb_eRuntimeError, "The block set has no graph.");
+		}
+		return set;
+	}
+	static long find(Set* set, VALUE element) {
+		if (!rb_typeddata_is_kind_of(element, &basic_block_type)) {
+			return -1;
+		}
+		BasicBlock *block;
+		TypedData_Get_Struct(element, BasicBlock, &basic_block_type, block);
+		return set->find(block);
+	}
+	static size_t intern(Set* set, VALUE element) {
+		BasicBlock *block;
+		TypedData_Get_Struct(element, BasicBlock, &basic_block_type, block);
+		long id = set->find(block);
+		if (id < 0) {
+			rb_raise(rb_eArgError, "The block %" PRIsVALUE " is not in the set's graph.", block->name());
+		}
+		return id;
+	}
+	// Qundef for an ID no block holds any more.
+	static VALUE element(Set* set, size_t id) {
+		BasicBlock* block = set->graph()->vertex(id);
+		return block ? block->representation() : Qundef;
+	}
+	static bool compatible(Set* set, Set* other) { return set->graph() == other->graph(); }
+	static void adopt(Set* set, Set* other) { set->attach(other->graph()); }
+};
+
+struct TempSetTraits {
+	typedef TempSet Set;
+	static const rb_data_type_t* type() { return &temp_set_type; }
+	static Set* get(VALUE self) {
+		TempSet *set;
+		TypedData_Get_Struct(self, TempSet, &temp_set_type, set);
+		if (!set->has_universe()) {
+			rb_raise(rb_eRuntimeError, "The temp set is not initialized.");
+		}
+		return set;
+	}
+	static long find(Set* set, VALUE element) { return set->find(element); }
+	static size_t intern(Set* set, VALUE element) { return set->intern(element); }
+	static VALUE element(Set* set, size_t id) { return set->temp(id); }
+	static bool compatible(Set* set, Set* other) { return set->shares_universe(*other); }
+	static void adopt(Set* set, Set* other) { set->share_universe(*other); }
+};
+
+// The other set, if it is of the same kind and compatible with set.
+template <class Traits>
+static typename Traits::Set* compatible_set(typename Traits::Set* set, VALUE other) {
+	if (!rb_typeddata_is_kind_of(other, Traits::type())) {
+		return NULL;
+	}
+	typename Traits::Set* other_set = Traits::get(other);
+	return Traits::compatible(set, other_set) ? other_set : NULL;
+}
+
+template <class Traits>
+static VALUE set_to_a(VALUE self) {
+	typename Traits::Set* set = Traits::get(self);
+	VALUE result = rb_ary_new();
+	for (size_t id = set->bits().next(0); id < set->bits().size(); id = set->bits().next(id + 1)) {
+		VALUE element = Traits::element(set, id);
+		if (element != Qundef) {
+			rb_ary_push(result, element);
+		}
+	}
+	return result;
+}
+
+template <class Traits>
+static VALUE set_elements(VALUE other) {
+	if (rb_typeddata_is_kind_of(other, Traits::type())) {
+		return set_to_a<Traits>(other);
+	}
+	return rb_convert_type(other, T_ARRAY, "Array", "to_a");
+}
+
+// A new, empty set of the same class and universe.
+template <class Traits>
+static VALUE set_sibling(VALUE self, typename Traits::Set* set) {
+	VALUE result = rb_obj_alloc(rb_obj_class(self));
+	typename Traits::Set* sibling;
+	TypedData_Get_Struct(result, typename Traits::Set, Traits::type(), sibling);
+	Traits::adopt(sibling, set);
+	return result;
+}
+
+template <class Traits>
+static VALUE set_copy(VALUE self) {
+	typename Traits::Set* set = Traits::get(self);
+	VALUE result = set_sibling<Traits>(self, set);
+	Traits::get(result)->bits() = set->bits();
+	return result;
+}
+
+template <class Traits>
+static VALUE set_initialize_copy(VALUE self, VALUE original) {
+	typename Traits::Set *set, *source = Traits::get(original);
+	TypedData_Get_Struct(self, typename Traits::Set, Traits::type(), set);
+	if (set != source) {
+		Traits::adopt(set, source);
+		set->bits() = source->bits();
+	}
+	return self;
+}
+
+template <class Traits>
+static VALUE set_add(VALUE self, VALUE element) {
+	typename Traits::Set* set = Traits::get(self);
+	size_t id = Traits::intern(set, element);
+	set->bits().set(id);
+	return self;
+}
+
+template <class Traits>
+static VALUE set_add_p(VALUE self, VALUE element) {
+	typename Traits::Set* set = Traits::get(self);
+	size_t id = Traits::intern(set, element);
+	return set->bits().add(id) ? self : Qnil;
+}
+
+template <class Traits>
+static VALUE set_delete_p(VALUE self, VALUE element) {
+	typename Traits::Set* set = Traits::get(self);
+	long id = Traits::find(set, element);
+	if (id < 0 || !set->bits().test(id)) {
+		return Qnil;
+	}
+	set->bits().reset(id);
+	return self;
+}
+
+template <class Traits>
+static VALUE set_delete(VALUE self, VALUE element) {
+	set_delete_p<Traits>(self, element);
+	return self;
+}
+
+template <class Traits>
+static VALUE set_include_p(VALUE self, VALUE element) {
+	typename Traits::Set* set = Traits::get(self);
+	long id = Traits::find(set, element);
+	return (id >= 0 && set->bits().test(id)) ? Qtrue : Qfalse;
+}
+
+template <class Traits>
+static VALUE set_size(VALUE self) {
+	return SIZET2NUM(Traits::get(self)->bits().count());
+}
+
+template <class Traits>
+static VALUE set_empty_p(VALUE self) {
+	return Traits::get(self)->bits().empty() ? Qtrue : Qfalse;
+}
+
+template <class Traits>
+static VALUE set_clear(VALUE self) {
+	Traits::get(self)->bits().clear();
+	return self;
+}
+
+// The block may change the set: each step looks for the next member
+// after the last one yielded.
+template <class Traits>
+static VALUE set_each(VALUE self) {
+	RETURN_ENUMERATOR(self, 0, 0);
+	typename Traits::Set* set = Traits::get(self);
+	for (size_t id = set->bits().next(0); id < set->bits().size(); id = set->bits().next(id + 1)) {
+		VALUE element = Traits::element(set, id);
+		if (element != Qundef) {
+			rb_yield(element);
+		}
+	}
+	return self;
+}
+
+// Removes and returns the member with the lowest ID, or nil.
+template <class Traits>
+static VALUE set_pop(VALUE self) {
+	typename Traits::Set* set = Traits::get(self);
+	Bitset& bits = set->bits();
+	for (size_t id = bits.next(0); id < bits.size(); id = bits.next(id + 1)) {
+		bits.reset(id);
+		VALUE element = Traits::element(set, id);
+		if (element != Qundef) {
+			return element;
+		}
+	}
+	return Qnil;
+}
+
+template <class Traits>
+static VALUE set_merge(VALUE self, VALUE other) {
+	typename Traits::Set* set = Traits::get(self);
+	typename Traits::Set* other_set = compatible_set<Traits>(set, other);
+	if (other_set) {
+		Bitset& bits = set->bits();
+		bits.union_with(other_set->bits());
+		return self;
+	}
+	VALUE elements = set_elements<Traits>(other);
+	for (long i = 0; i < RARRAY_LEN(elements); ++i) {
+		size_t id = Traits::intern(set, rb_ary_entry(elements, i));
+		set->bits().set(id);
+	}
+	return self;
+}
+
+template <class Traits>
+static VALUE set_subtract(VALUE self, VALUE other) {
+	typename Traits::Set* set = Traits::get(self);
+	typename Traits::Set* other_set = compatible_set<Traits>(set, other);
+	if (other_set) {
+		Bitset& bits = set->bits();
+		bits.subtract(other_set->bits());
+		return self;
+	}
+	VALUE elements = set_elements<Traits>(other);
+	for (long i = 0; i < RARRAY_LEN(elements); ++i) {
+		long id = Traits::find(set, rb_ary_entry(elements, i));
+		if (id >= 0) {
+			set->bits().reset(id);
+		}
+	}
+	return self;
+}
+
+template <class Traits>
+static VALUE set_intersect(VALUE self, VALUE other) {
+	typename Traits::Set* set = Traits::get(self);
+	typename Traits::Set* other_set = compatible_set<Traits>(set, other);
+	if (other_set) {
+		Bitset& bits = set->bits();
+		bits.intersect_with(other_set->bits());
+		return self;
+	}
+	VALUE elements = set_elements<Traits>(other);
+	Bitset kept(set->bits().size());
+	for (long i = 0; i < RARRAY_LEN(elements); ++i) {
+		long id = Traits::find(set, rb_ary_entry(elements, i));
+		if (id >= 0 && set->bits().test(id)) {
+			kept.set(id);
+		}
+	}
+	set->bits() = kept;
+	return self;
+}
+
+template <class Traits>
+static VALUE set_union(VALUE self, VALUE other) {
+	return set_merge<Traits>(set_copy<Traits>(self), other);
+}
+
+template <class Traits>
+static VALUE set_difference(VALUE self, VALUE other) {
+	return set_subtract<Traits>(set_copy<Traits>(self), other);
+}
+
+template <class Traits>
+static VALUE set_intersection(VALUE self, VALUE other) {
+	return set_intersect<Traits>(set_copy<Traits>(self), other);
+}
+
+template <class Traits>
+static VALUE set_equal(VALUE self, VALUE other) {
+	if (!rb_typeddata_is_kind_of(other, Traits::type())) {
+		return Qfalse;
+	}
+	typename Traits::Set* set = Traits::get(self);
+	typename Traits::Set* other_set = Traits::get(other);
+	if (Traits::compatible(set, other_set)) {
+		Bitset& bits = set->bits();
+		return (bits == other_set->bits()) ? Qtrue : Qfalse;
+	}
+	VALUE elements = set_to_a<Traits>(other);
+	if ((size_t)RARRAY_LEN(elements) != set->bits().count()) {
+		return Qfalse;
+	}
+	for (long i = 0; i < RARRAY_LEN(elements); ++i) {
+		if (!RTEST(set_include_p<Traits>(self, rb_ary_entry(elements, i)))) {
+			return Qfalse;
+		}
+	}
+	return Qtrue;
+}
+
+template <class Traits>
+static VALUE set_inspect(VALUE self) {
+	return rb_sprintf("#<%" PRIsVALUE ": %" PRIsVALUE ">", rb_class_name(rb_obj_class(self)),
+	                  rb_inspect(set_to_a<Traits>(self)));
+}
+
+template <class Traits>
+static void define_set_methods(VALUE klass) {
+	rb_include_module(klass, rb_mEnumerable);
+	rb_define_method(klass, "initialize_copy", RUBY_METHOD_FUNC(set_initialize_copy<Traits>), 1);
+	rb_define_method(klass, "add", RUBY_METHOD_FUNC(set_add<Traits>), 1);
+	rb_define_method(klass, "<<", RUBY_METHOD_FUNC(set_add<Traits>), 1);
+	rb_define_method(klass, "add?", RUBY_METHOD_FUNC(set_add_p<Traits>), 1);
+	rb_define_method(klass, "delete", RUBY_METHOD_FUNC(set_delete<Traits>), 1);
+	rb_define_method(klass, "delete?", RUBY_METHOD_FUNC(set_delete_p<Traits>), 1);
+	rb_define_method(klass, "include?", RUBY_METHOD_FUNC(set_include_p<Traits>), 1);
+	rb_define_method(klass, "member?", RUBY_METHOD_FUNC(set_include_p<Traits>), 1);
+	rb_define_method(klass, "size", RUBY_METHOD_FUNC(set_size<Traits>), 0);
+	rb_define_method(klass, "length", RUBY_METHOD_FUNC(set_size<Traits>), 0);
+	rb_define_method(klass, "empty?", RUBY_METHOD_FUNC(set_empty_p<Traits>), 0);
+	rb_define_method(klass, "clear", RUBY_METHOD_FUNC(set_clear<Traits>), 0);
+	rb_define_method(klass, "each", RUBY_METHOD_FUNC(set_each<Traits>), 0);
+	rb_define_method(klass, "pop", RUBY_METHOD_FUNC(set_pop<Traits>), 0);
+	rb_define_method(klass, "to_a", RUBY_METHOD_FUNC(set_to_a<Traits>), 0);
+	rb_define_method(klass, "merge", RUBY_METHOD_FUNC(set_merge<Traits>), 1);
+	rb_define_method(klass, "subtract", RUBY_METHOD_FUNC(set_subtract<Traits>), 1);
+	rb_define_method(klass, "|", RUBY_METHOD_FUNC(set_union<Traits>), 1);
+	rb_define_method(klass, "union", RUBY_METHOD_FUNC(set_union<Traits>), 1);
+	rb_define_method(klass, "+", RUBY_METHOD_FUNC(set_union<Traits>), 1);
+	rb_define_method(klass, "&", RUBY_METHOD_FUNC(set_intersection<Traits>), 1);
+	rb_define_method(klass, "intersection", RUBY_METHOD_FUNC(set_intersection<Traits>), 1);
+	rb_define_method(klass, "-", RUBY_METHOD_FUNC(set_difference<Traits>), 1);
+	rb_define_method(klass, "difference", RUBY_METHOD_FUNC(set_difference<Traits>), 1);
+	rb_define_method(klass, "==", RUBY_METHOD_FUNC(set_equal<Traits>), 1);
+	rb_define_method(klass, "inspect", RUBY_METHOD_FUNC(set_inspect<Traits>), 0);
+}
+
+extern "C" {
+	static VALUE block_set_initialize(int argc, VALUE* argv, VALUE self) {
+		VALUE graph, blocks;
+		rb_scan_args(argc, argv, "11", &graph, &blocks);
+		BlockSet *set;
+		ControlFlowGraph *base;
+		TypedData_Get_Struct(self, BlockSet, &block_set_type, set);
+		TypedData_Get_Struct(graph, ControlFlowGraph, &control_flow_graph_type, base);
+		if (set->graph()) {
+			rb_raise(rb_eRuntimeError, "The block set already has a graph.");
+		}
+		set->attach(base);
+		if (!NIL_P(blocks)) {
+			set_merge<BlockSetTraits>(self, blocks);
+		}
+		return Qnil;
+	}
+
+	static VALUE block_set_graph(VALUE self) {
+		return BlockSetTraits::get(self)->graph()->representation();
+	}
+
+	// The universe is taken from another TempSet if one is given.
+	static VALUE temp_set_initialize(int argc, VALUE* argv, VALUE self) {
+		VALUE temps, universe;
+		rb_scan_args(argc, argv, "02", &temps, &universe);
+		TempSet *set;
+		TypedData_Get_Struct(self, TempSet, &temp_set_type, set);
+		if (set->has_universe()) {
+			rb_raise(rb_eRuntimeError, "The temp set is already initialized.");
+		}
+		if (NIL_P(universe)) {
+			set->create_universe();
+		} else {
+			set->share_universe(*TempSetTraits::get(universe));
+		}
+		if (!NIL_P(temps)) {
+			set_merge<TempSetTraits>(self, temps);
+		}
+		return Qnil;
+	}
+
+	void Init_Sets() {
+		rb_cBlockSet = rb_define_class_under(rb_mControlFlow, "BlockSet", rb_cObject);
+		rb_define_alloc_func(rb_cBlockSet, block_set_alloc);
+		rb_define_method(rb_cBlockSet, "initialize", RUBY_METHOD_FUNC(block_set_initialize), -1);
+		rb_define_method(rb_cBlockSet, "graph", RUBY_METHOD_FUNC(block_set_graph), 0);
+		define_set_methods<BlockSetTraits>(rb_cBlockSet);
+
+		rb_cTempSet = rb_define_class_under(rb_mControlFlow, "TempSet", rb_cObject);
+		rb_define_alloc_func(rb_cTempSet, temp_set_alloc);
+		rb_define_method(rb_cTempSet, "initialize", RUBY_METHOD_FUNC(temp_set_initialize), -1);
+		define_set_methods<TempSetTraits>(rb_cTempSet);
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef LASER_SETS_H_
+#define LASER_SETS_H_
+
+#include "BasicBlock.h"
+#include "Bitset.h"
+#include "ruby.h"
+
+namespace Laser {
+	class ControlFlowGraph;
+	// Sets over dense IDs, for the bookkeeping of analysis passes. They are
+	// bitsets, so membership is a bit test and union, intersection and
+	// difference work a word at a time, with no hashing and no comparison
+	// of elements. Members iterate in ID order.
+
+	// The blocks of one graph, by block ID. Like the graph's other per-ID
+	// arrays it is meant to last a pass: a block removed from the graph
+	// leaves its ID in the set, and a block added later may reuse it.
+	class BlockSet {
+	  public:
+		BlockSet() : _graph(NULL) {}
+		~BlockSet();
+		void attach(ControlFlowGraph* graph);
+		inline ControlFlowGraph* graph() { return _graph; }
+		// The block's ID, or -1 if it is not in the graph.
+		long find(BasicBlock* block);
+		// Sized to the graph's IDs.
+		Bitset& bits();
+
+		void mark();
+		size_t memsize();
+
+	  private:
+		ControlFlowGraph* _graph;
+		Bitset _bits;
+	};
+
+	// Temps, or any objects, by identity. IDs are handed out in the order
+	// temps are first added to any set of a universe; sets made from one
+	// another share it, and only then are their operations word-wise.
+	class TempSet {
+	  public:
+		TempSet() : _ids(Qnil), _temps(Qnil) {}
+		inline bool has_universe() { return _ids != Qnil; }
+		void create_universe();
+		void share_universe(TempSet& other);
+		inline bool shares_universe(TempSet& other) { return _ids == other._ids; }
+		// The temp's ID, or -1 if no set of the universe has held it.
+		long find(VALUE temp);
+		size_t intern(VALUE temp);
+		inline VALUE temp(size_t id) { return rb_ary_entry(_temps, id); }
+		// Sized to the universe.
+		Bitset& bits();
+
+		void mark();
+		void compact();
+		size_t memsize();
+
+	  private:
+		// An identity Hash from temps to IDs, and an Array the other way.
+		VALUE _ids;
+		VALUE _temps;
+		Bitset _bits;
+	};
+}
+extern VALUE rb_cBlockSet;
+extern VALUE rb_cTempSet;
+extern "C" {
+	void Init_Sets();
+}
+
+#endif
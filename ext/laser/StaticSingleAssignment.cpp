@@ -0,0 +1,416 @@
+#include "StaticSingleAssignment.h"
+#include "ruby.h"
+
+VALUE rb_mStaticSingleAssignment;
+VALUE rb_cSSARenamer;
+
+using namespace Laser;
+
+static ID id_body;
+static ID id_name;
+static ID id_ssa_define;
+static ID id_ssa_initialize_before;
+static ID id_ssa_initialize_phi_operands;
+static ID id_ssa_add_uses;
+static VALUE sym_phi;
+static VALUE sym_assign;
+static VALUE sym_call;
+static VALUE sym_call_vararg;
+static VALUE sym_super;
+static VALUE sym_super_vararg;
+static VALUE sym_lambda;
+static VALUE sym_declare;
+static VALUE sym_alias;
+static VALUE sym_expect_tuple_size;
+static VALUE sym_block;
+
+static inline VALUE instruction_body(VALUE instruction) {
+	return rb_ivar_get(instruction, id_body);
+}
+
+// Instruction#explicit_targets: the types that can set their first operand.
+static inline bool defines_target(VALUE type) {
+	return type == sym_assign || type == sym_call || type == sym_call_vararg || type == sym_super ||
+	       type == sym_super_vararg || type == sym_lambda || type == sym_phi;
+}
+
+void SSARenamer::configure(VALUE binding_class, VALUE constant_class, VALUE ignored) {
+	_binding_class = binding_class;
+	_constant_class = constant_class;
+	_ignored = ignored;
+	_temp_ids = rb_hash_new();
+	rb_funcall(_temp_ids, rb_intern("compare_by_identity"), 0);
+}
+
+uint32_t SSARenamer::intern_temp(VALUE temp) {
+	VALUE id = rb_hash_lookup2(_temp_ids, temp, Qnil);
+	if (id != Qnil) {
+		return FIX2LONG(id);
+	}
+	uint32_t new_id = _names.size();
+	rb_hash_aset(_temp_ids, temp, LONG2FIX(new_id));
+	_names.push_back(std::vector<VALUE>());
+	_versions.push_back(0);
+	return new_id;
+}
+
+VALUE SSARenamer::current_name(VALUE temp) {
+	VALUE id = rb_hash_lookup2(_temp_ids, temp, Qnil);
+	if (id == Qnil || _names[FIX2LONG(id)].empty()) {
+		return Qnil;
+	}
+	return _names[FIX2LONG(id)].back();
+}
+
+// Bindings are Comparable by name, so any binding named like the ignored
+// one is ignored too.
+bool SSARenamer::is_ignored(VALUE binding) {
+	return binding == _ignored || RTEST(rb_equal(rb_ivar_get(binding, id_name), rb_ivar_get(_ignored, id_name)));
+}
+
+// Instruction#operands: the bindings that aren't ignored.
+bool SSARenamer::is_operand(VALUE value) {
+	return RTEST(rb_obj_is_kind_of(value, _binding_class)) && !is_ignored(value);
+}
+
+// Instruction#operand_range, as a start index, or -1 for none.
+long SSARenamer::operand_start(VALUE body) {
+	VALUE type = rb_ary_entry(body, 0);
+	if (type == sym_assign || type == sym_call_vararg || type == sym_super || type == sym_super_vararg ||
+	    type == sym_lambda || type == sym_phi) {
+		return 2;
+	} else if (type == sym_declare) {
+		VALUE kind = rb_ary_entry(body, 1);
+		return (kind == sym_alias) ? 2 : (kind == sym_expect_tuple_size) ? 4 : -1;
+	} else if (type == sym_call) {
+		return RTEST(rb_obj_is_kind_of(rb_ary_entry(body, 2), _constant_class)) ? 3 : 2;
+	}
+	return 1;
+}
+
+void SSARenamer::seed(VALUE temp, VALUE name) {
+	_names[intern_temp(temp)].push_back(name);
+}
+
+void SSARenamer::push_name(uint32_t temp, VALUE name, VALUE definition) {
+	_names[temp].push_back(name);
+	Definition logged = { definition, temp };
+	_definitions.push_back(logged);
+}
+
+VALUE SSARenamer::define(VALUE temp, VALUE definition) {
+	uint32_t id = intern_temp(temp);
+	VALUE name = rb_funcall(_graph, id_ssa_define, 3, temp, UINT2NUM(++_versions[id]), definition);
+	push_name(id, name, definition);
+	return name;
+}
+
+// Renames the operands of the instruction at index, initializing any temp
+// read before it is written. The initializing assignments go before the
+// instruction, and index is moved past them. Uses are recorded before the
+// operands are rewritten, as an instruction hashes by its contents.
+void SSARenamer::rename_operands(BasicBlock* block, VALUE instructions, long& index) {
+	VALUE instruction = rb_ary_entry(instructions, index);
+	VALUE body = instruction_body(instruction);
+	VALUE uses = Qnil;
+	long start = operand_start(body);
+	for (long i = start; start >= 0 && i < RARRAY_LEN(body); ++i) {
+		VALUE operand = rb_ary_entry(body, i);
+		if (!is_operand(operand)) {
+			continue;
+		}
+		VALUE name = current_name(operand);
+		if (name == Qnil) {
+			uint32_t id = intern_temp(operand);
+			long size = RARRAY_LEN(instructions);
+			name = rb_funcall(_graph, id_ssa_initialize_before, 4, operand, UINT2NUM(++_versions[id]),
+			                  block->representation(), LONG2NUM(index));
+			VALUE assignment = Qnil;
+			if (RARRAY_LEN(instructions) > size) {
+				assignment = rb_ary_entry(instructions, index);
+				index += RARRAY_LEN(instructions) - size;
+			}
+			push_name(id, name, assignment);
+		}
+		if (uses == Qnil) {
+			uses = rb_ary_new();
+		}
+		rb_ary_push(uses, name);
+	}
+	long operands = (uses == Qnil) ? 0 : RARRAY_LEN(uses);
+	VALUE last = rb_ary_entry(body, -1);
+	VALUE block_name = Qnil;
+	if (RB_TYPE_P(last, T_HASH)) {
+		VALUE block_operand = rb_hash_lookup2(last, sym_block, Qnil);
+		if (RTEST(block_operand)) {
+			block_name = current_name(block_operand);
+			if (block_name == Qnil) {
+				rb_raise(rb_eRuntimeError, "The block operand %" PRIsVALUE " is used before it is defined.",
+				         rb_inspect(block_operand));
+			}
+			if (uses == Qnil) {
+				uses = rb_ary_new();
+			}
+			rb_ary_push(uses, block_name);
+		}
+	}
+	if (uses == Qnil) {
+		return;
+	}
+	rb_funcall(_graph, id_ssa_add_uses, 2, instruction, uses);
+	long next = 0;
+	for (long i = start; next < operands && i < RARRAY_LEN(body); ++i) {
+		if (is_operand(rb_ary_entry(body, i))) {
+			rb_ary_store(body, i, rb_ary_entry(uses, next++));
+		}
+	}
+	if (block_name != Qnil) {
+		rb_hash_aset(last, sym_block, block_name);
+	}
+}
+
+// Phi nodes are evaluated upon entering a block, so they define their
+// temps first. Then each instruction's uses are renamed before its
+// definition, and finally the successors' phi operands for this block.
+void SSARenamer::enter_block(BasicBlock* block) {
+	VALUE instructions = block->instructions();
+	long phi_count = block->phi_count();
+	for (long i = 0; i < phi_count; ++i) {
+		VALUE instruction = rb_ary_entry(instructions, i);
+		define(rb_ary_entry(instruction_body(instruction), 1), instruction);
+	}
+	for (long i = phi_count; i < RARRAY_LEN(instructions); ++i) {
+		rename_operands(block, instructions, i);
+		VALUE instruction = rb_ary_entry(instructions, i);
+		VALUE body = instruction_body(instruction);
+		VALUE target = rb_ary_entry(body, 1);
+		if (defines_target(rb_ary_entry(body, 0)) && RTEST(target) && !is_ignored(target)) {
+			define(target, instruction);
+		}
+	}
+	// Initializing phi operands inserts blocks on the edges out of this
+	// one, so the successors are taken up front.
+	_successors.clear();
+	std::vector<BasicBlock::Edge*>& edges = block->successors();
+	for (std::vector<BasicBlock::Edge*>::iterator edge = edges.begin(); edge < edges.end(); ++edge) {
+		if (((*edge)->flags & EDGE_FAKE) == 0) {
+			_successors.push_back((*edge)->to);
+		}
+	}
+	for (size_t i = 0; i < _successors.size(); ++i) {
+		rename_successor_phis(block, _successors[i]);
+	}
+}
+
+// The phi operand for this block is the one at the block's position among
+// the successor's real predecessors. Temps with no name along this edge
+// get one from an assignment in a block inserted on the edge, which is
+// only in scope for the phi operands.
+void SSARenamer::rename_successor_phis(BasicBlock* block, BasicBlock* successor) {
+	std::vector<BasicBlock::Edge*>& preds = successor->predecessors();
+	long position = 0;
+	for (std::vector<BasicBlock::Edge*>::iterator pred = preds.begin(); pred < preds.end(); ++pred) {
+		if ((*pred)->flags & EDGE_FAKE) {
+			continue;
+		}
+		if ((*pred)->from == block) {
+			break;
+		}
+		++position;
+	}
+	long slot = position + 2;
+	VALUE instructions = successor->instructions();
+	long phi_count = successor->phi_count();
+	VALUE uninitialized = Qnil;
+	VALUE versions = Qnil;
+	for (long i = 0; i < phi_count; ++i) {
+		VALUE instruction = rb_ary_entry(instructions, i);
+		VALUE body = instruction_body(instruction);
+		if (current_name(rb_ary_entry(body, slot)) == Qnil) {
+			if (uninitialized == Qnil) {
+				uninitialized = rb_ary_new();
+				versions = rb_ary_new();
+			}
+			uint32_t id = intern_temp(rb_ary_entry(body, 1));
+			rb_ary_push(uninitialized, instruction);
+			rb_ary_push(versions, UINT2NUM(++_versions[id]));
+		}
+	}
+	size_t scoped = _definitions.size();
+	if (uninitialized != Qnil) {
+		VALUE names = rb_funcall(_graph, id_ssa_initialize_phi_operands, 5, block->representation(),
+		                         successor->representation(), LONG2NUM(position), uninitialized, versions);
+		for (long i = 0; i < RARRAY_LEN(uninitialized); ++i) {
+			VALUE body = instruction_body(rb_ary_entry(uninitialized, i));
+			push_name(intern_temp(rb_ary_entry(body, 1)), rb_ary_entry(names, i), Qnil);
+		}
+	}
+	for (long i = 0; i < phi_count; ++i) {
+		VALUE instruction = rb_ary_entry(instructions, i);
+		VALUE body = instruction_body(instruction);
+		VALUE replacement = current_name(rb_ary_entry(body, slot));
+		if (replacement == Qnil) {
+			rb_raise(rb_eRuntimeError, "The phi operand %" PRIsVALUE " has no name.",
+			         rb_inspect(rb_ary_entry(body, slot)));
+		}
+		rb_ary_store(body, slot, replacement);
+		rb_funcall(_graph, id_ssa_add_uses, 2, instruction, rb_ary_new_from_args(1, replacement));
+	}
+	while (_definitions.size() > scoped) {
+		_names[_definitions.back().temp].pop_back();
+		_definitions.pop_back();
+	}
+}
+
+// Pops the names defined in the block, latest first, storing each as the
+// target of its definition.
+void SSARenamer::leave_block(Frame& frame) {
+	while (_definitions.size() > frame.definitions) {
+		Definition& definition = _definitions.back();
+		VALUE name = _names[definition.temp].back();
+		_names[definition.temp].pop_back();
+		if (definition.instruction != Qnil) {
+			rb_ary_store(instruction_body(definition.instruction), 1, name);
+		}
+		_definitions.pop_back();
+	}
+}
+
+void SSARenamer::run(VALUE graph, BasicBlock* start) {
+	_graph = graph;
+	_frames.clear();
+	_definitions.clear();
+	BasicBlock* next = start;
+	while (next != NULL) {
+		_frames.push_back(Frame());
+		Frame& frame = _frames.back();
+		frame.block = next;
+		frame.definitions = _definitions.size();
+		if (next->has_dominator_info()) {
+			frame.children = next->dominated_children();
+		}
+		frame.next_child = 0;
+		enter_block(next);
+		next = NULL;
+		while (next == NULL && !_frames.empty()) {
+			Frame& top = _frames.back();
+			if (top.next_child < top.children.size()) {
+				next = top.children[top.next_child++];
+			} else {
+				leave_block(top);
+				_frames.pop_back();
+			}
+		}
+	}
+	_graph = Qnil;
+}
+
+// Everything is pinned: names are looked up by identity while renaming,
+// and a renamer only lives for one run.
+void SSARenamer::mark() {
+	rb_gc_mark(_graph);
+	rb_gc_mark(_binding_class);
+	rb_gc_mark(_constant_class);
+	rb_gc_mark(_ignored);
+	rb_gc_mark(_temp_ids);
+	for (std::vector<std::vector<VALUE> >::iterator names = _names.begin(); names < _names.end(); ++names) {
+		for (std::vector<VALUE>::iterator name = names->begin(); name < names->end(); ++name) {
+			rb_gc_mark(*name);
+		}
+	}
+	for (std::vector<Definition>::iterator it = _definitions.begin(); it < _definitions.end(); ++it) {
+		rb_gc_mark(it->instruction);
+	}
+}
+
+size_t SSARenamer::memsize() {
+	size_t size = sizeof(SSARenamer) + _versions.capacity() * sizeof(uint32_t) +
+	              _names.capacity() * sizeof(std::vector<VALUE>) +
+	              _definitions.capacity() * sizeof(Definition) + _frames.capacity() * sizeof(Frame) +
+	              _successors.capacity() * sizeof(BasicBlock*);
+	for (std::vector<std::vector<VALUE> >::iterator names = _names.begin(); names < _names.end(); ++names) {
+		size += names->capacity() * sizeof(VALUE);
+	}
+	for (std::vector<Frame>::iterator frame = _frames.begin(); frame < _frames.end(); ++frame) {
+		size += frame->children.capacity() * sizeof(BasicBlock*);
+	}
+	return size;
+}
+
+extern "C" {
+	static void ssa_mark(void* renamer) {
+		static_cast<SSARenamer*>(renamer)->mark();
+	}
+
+	static void ssa_free(void* renamer) {
+		delete static_cast<SSARenamer*>(renamer);
+	}
+
+	static size_t ssa_memsize(const void* renamer) {
+		return ((SSARenamer*)renamer)->memsize();
+	}
+
+	static const rb_data_type_t ssa_renamer_type = {
+		"Laser::Analysis::ControlFlow::StaticSingleAssignment::Renamer",
+		{ ssa_mark, ssa_free, ssa_memsize, },
+		NULL, NULL, RUBY_TYPED_FREE_IMMEDIATELY
+	};
+
+	static VALUE ssa_alloc(VALUE klass) {
+		SSARenamer *renamer = new SSARenamer;
+		return TypedData_Wrap_Struct(klass, &ssa_renamer_type, renamer);
+	}
+
+	static VALUE ssa_initialize(VALUE self, VALUE binding_class, VALUE constant_class, VALUE ignored) {
+		SSARenamer *renamer;
+		TypedData_Get_Struct(self, SSARenamer, &ssa_renamer_type, renamer);
+		renamer->configure(binding_class, constant_class, ignored);
+		return Qnil;
+	}
+
+	static VALUE ssa_seed(VALUE self, VALUE temp, VALUE name) {
+		SSARenamer *renamer;
+		TypedData_Get_Struct(self, SSARenamer, &ssa_renamer_type, renamer);
+		renamer->seed(temp, name);
+		return self;
+	}
+
+	// Renames the blocks start dominates, calling back the graph's
+	// ssa_define, ssa_initialize_before, ssa_initialize_phi_operands, and
+	// ssa_add_uses.
+	static VALUE ssa_run(VALUE self, VALUE graph, VALUE start) {
+		SSARenamer *renamer;
+		BasicBlock *start_block;
+		TypedData_Get_Struct(self, SSARenamer, &ssa_renamer_type, renamer);
+		TypedData_Get_Struct(start, BasicBlock, &basic_block_type, start_block);
+		renamer->run(graph, start_block);
+		return self;
+	}
+
+	void Init_StaticSingleAssignment() {
+		id_body = rb_intern("@body");
+		id_name = rb_intern("@name");
+		id_ssa_define = rb_intern("ssa_define");
+		id_ssa_initialize_before = rb_intern("ssa_initialize_before");
+		id_ssa_initialize_phi_operands = rb_intern("ssa_initialize_phi_operands");
+		id_ssa_add_uses = rb_intern("ssa_add_uses");
+		sym_phi = ID2SYM(rb_intern("phi"));
+		sym_assign = ID2SYM(rb_intern("assign"));
+		sym_call = ID2SYM(rb_intern("call"));
+		sym_call_vararg = ID2SYM(rb_intern("call_vararg"));
+		sym_super = ID2SYM(rb_intern("super"));
+		sym_super_vararg = ID2SYM(rb_intern("super_vararg"));
+		sym_lambda = ID2SYM(rb_intern("lambda"));
+		sym_declare = ID2SYM(rb_intern("declare"));
+		sym_alias = ID2SYM(rb_intern("alias"));
+		sym_expect_tuple_size = ID2SYM(rb_intern("expect_tuple_size"));
+		sym_block = ID2SYM(rb_intern("block"));
+
+		rb_mStaticSingleAssignment = rb_define_module_under(rb_mControlFlow, "StaticSingleAssignment");
+		rb_cSSARenamer = rb_define_class_under(rb_mStaticSingleAssignment, "Renamer", rb_cObject);
+		rb_define_alloc_func(rb_cSSARenamer, ssa_alloc);
+		rb_define_method(rb_cSSARenamer, "initialize", RUBY_METHOD_FUNC(ssa_initialize), 3);
+		rb_define_method(rb_cSSARenamer, "seed", RUBY_METHOD_FUNC(ssa_seed), 2);
+		rb_define_method(rb_cSSARenamer, "run", RUBY_METHOD_FUNC(ssa_run), 2);
+	}
+}
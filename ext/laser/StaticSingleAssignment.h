@@ -0,0 +1,82 @@
+#ifndef LASER_STATIC_SINGLE_ASSIGNMENT_H_
+#define LASER_STATIC_SINGLE_ASSIGNMENT_H_
+
+#include <vector>
+#include "BasicBlock.h"
+#include "ruby.h"
+
+namespace Laser {
+	// Renames the temps of a CFG into SSA form, Morgan p.175: walks the
+	// dominator tree from the start block, giving each definition a new
+	// name and each use the name on top of its temp's stack. The walk uses
+	// an explicit stack, so deep dominator trees can't overflow the C stack.
+	//
+	// Temps get dense IDs, each with a stack of its current names. The
+	// definitions made in a block are logged, so leaving the block pops
+	// exactly those names, storing each as its definition's target.
+	//
+	// Instructions are read and rewritten natively. The graph is called
+	// back only to create bindings, to insert the assignments that
+	// initialize temps read before they are written, and to record uses.
+	// Any callback may raise, so the walk's state lives on the renamer.
+	class SSARenamer {
+	  public:
+		SSARenamer() : _graph(Qnil), _binding_class(Qnil), _constant_class(Qnil), _ignored(Qnil),
+		               _temp_ids(Qnil) {}
+		// Takes the class of the bindings that are renamed, the class of
+		// constant bindings, and a binding that is never renamed.
+		void configure(VALUE binding_class, VALUE constant_class, VALUE ignored);
+		// Gives the temp a name before the walk starts, as for formals.
+		void seed(VALUE temp, VALUE name);
+		void run(VALUE graph, BasicBlock* start);
+
+		void mark();
+		size_t memsize();
+
+	  private:
+		struct Definition {
+			// The instruction whose target becomes the name, if any.
+			VALUE instruction;
+			uint32_t temp;
+		};
+		struct Frame {
+			BasicBlock* block;
+			size_t definitions;
+			// The children at entry: blocks inserted while renaming the
+			// block, on edges out of it, are not renamed.
+			std::vector<BasicBlock*> children;
+			size_t next_child;
+		};
+
+		uint32_t intern_temp(VALUE temp);
+		VALUE current_name(VALUE temp);
+		bool is_ignored(VALUE binding);
+		bool is_operand(VALUE value);
+		long operand_start(VALUE body);
+		VALUE define(VALUE temp, VALUE definition);
+		void push_name(uint32_t temp, VALUE name, VALUE definition);
+		void enter_block(BasicBlock* block);
+		void rename_operands(BasicBlock* block, VALUE instructions, long& index);
+		void rename_successor_phis(BasicBlock* block, BasicBlock* successor);
+		void leave_block(Frame& frame);
+
+		VALUE _graph;
+		VALUE _binding_class;
+		VALUE _constant_class;
+		// Bindings equal to this one, by name, are never renamed.
+		VALUE _ignored;
+		VALUE _temp_ids;
+		// Per temp ID: the stack of names, and the last version handed out.
+		std::vector<std::vector<VALUE> > _names;
+		std::vector<uint32_t> _versions;
+		std::vector<Definition> _definitions;
+		std::vector<Frame> _frames;
+		// Scratch space for the block being entered.
+		std::vector<BasicBlock*> _successors;
+	};
+}
+extern "C" {
+	void Init_StaticSingleAssignment();
+}
+
+#endif
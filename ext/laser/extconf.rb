@@ -1,3 +1,6 @@
 require 'mkmf'
 have_library('stdc++')
-create_makefile('laser/BasicBlock')
\ No newline at end of file
+have_header('ruby/thread.h')
+have_func('rb_thread_call_without_gvl', 'ruby/thread.h')
+have_func('rb_gc_mark_movable')
+create_makefile('laser/BasicBlock')
@@ -27,6 +27,7 @@ module Laser
   end
 end
 Laser::SETTINGS[:debug] = (ENV['LASER_DEBUG'] == 'true')
+Laser::SETTINGS[:cache_dir] = ENV['LASER_CACHE_DIR']
 
 # Dependencies
 require 'ripper'
@@ -47,6 +48,7 @@ require 'laser/support/inheritable_attributes'
 require 'laser/support/acts_as_struct'
 require 'laser/support/module_extensions'
 require 'laser/support/frequency'
+require 'laser/support/stats'
 require 'laser/analysis/errors'
 require 'laser/analysis/lexical_analysis'
 
@@ -56,6 +58,7 @@ require 'laser/analysis/sexp_extensions/source_location'
 
 require 'laser/analysis/sexp'
 require 'laser/analysis/sexp_analysis'
+require 'laser/analysis/parse_cache'
 
 require 'laser/analysis/arity'
 require 'laser/analysis/argument_expansion'
@@ -97,6 +100,9 @@ require 'laser/analysis/annotations'
 require 'laser/analysis/method_analysis/method_analysis'
 # Runners
 require 'laser/runner'
+require 'laser/client'
+require 'laser/server'
+require 'laser/worker_pool'
 require 'laser/rake/task'
 # Program logic
 require 'laser/warning'
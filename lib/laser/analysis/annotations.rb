@@ -9,7 +9,8 @@ module Laser
       # Performs full analysis on the given inputs.
       def self.annotate_inputs(inputs, opts={})
         inputs.map! do |filename, text|
-          [filename, text, Sexp.new(RipperPlus.sexp(text), filename, text)]
+          tree = Stats.time(:parse, filename) { Sexp.new(ParseCache.sexp(text), filename, text) }
+          [filename, text, tree]
         end
         apply_inherited_attributes(inputs)
         perform_load_time_analysis(inputs, opts)
@@ -26,7 +27,7 @@ module Laser
               time = Benchmark.realtime { annotator.annotate_with_text(tree, text) }
               puts "Time spent running #{annotator.class} on #{filename}: #{time}"
             else
-              annotator.annotate_with_text(tree, text)
+              Stats.time(:annotate, filename) { annotator.annotate_with_text(tree, text) }
             end
           end
         end
@@ -1,5 +1,6 @@
 require 'laser/BasicBlock'
 require 'laser/analysis/control_flow/basic_block'
+require 'laser/analysis/control_flow/overlay'
 require 'laser/analysis/control_flow/cfg_instruction'
 require 'laser/analysis/control_flow/unused_variables'
 require 'laser/analysis/control_flow/unreachability_analysis'
@@ -20,7 +21,7 @@ module Laser
   module Analysis
     module ControlFlow
       def self.perform_cfg_analysis(tree, text, opts={})
-        graph = GraphBuilder.new(tree).build
+        graph = Stats.time(:build, tree.file_name) { GraphBuilder.new(tree).build }
         graph.analyze(opts)
         graph
       end
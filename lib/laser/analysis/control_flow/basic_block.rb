@@ -5,15 +5,14 @@ module Laser
     module ControlFlow
       # Can't use the < DelegateClass(Array) syntax because of code reloading.
       class BasicBlock
-        def duplicate_for_graph_copy(temp_lookup, insn_lookup)
-          result = BasicBlock.new(name)
-          instructions.each do |insn|
+        # Fills in the instructions of this block's copy made by
+        # ControlFlowGraph#copy_topology, which already has the edges.
+        def copy_instructions_for_graph_copy(result, temp_lookup, insn_lookup)
+          result.instructions = instructions.map do |insn|
             copy = insn.deep_dup(temp_lookup, block: result)
             insn_lookup[insn] = copy
-            result.instructions << copy
             copy
           end
-          # successors/predecessors will be inserted by graph copy.
           result
         end
         
@@ -25,27 +24,10 @@ module Laser
           has_flag?(dest, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
         end
 
-        def real_successors
-          successors.reject { |dest| has_flag?(dest, RGL::ControlFlowGraph::EDGE_FAKE) }
-        end
-        
-        def normal_successors
-          successors.reject { |dest| has_flag?(dest, RGL::ControlFlowGraph::EDGE_ABNORMAL) }
-        end
-
         def variables
           Set.new(instructions.map(&:explicit_targets).inject(:|))
         end
         
-        # Gets all SSA Phi nodes that are in the block.
-        def phi_nodes
-          instructions.select { |ins| :phi == ins[0] }
-        end
-        
-        def natural_instructions
-          instructions.reject { |ins| :phi == ins[0] }
-        end
-
         def fall_through_block?
           instructions.empty?
         end
@@ -59,17 +41,37 @@ module Laser
             last_insn[1].uses.delete last_insn
             last_insn.body.replace([:jump, which_to_keep])
           end
-          # must update phi nodes.
-          unless dest.phi_nodes.empty?
-            which_phi_arg = dest.predecessors.to_a.index(self) + 2
-            dest.phi_nodes.each do |node|
-              node.delete_at(which_phi_arg)
+          # must update phi nodes. Their args follow dest's real
+          # predecessors, and removing an edge moves dest's last incoming
+          # edge, real or fake, into the removed one's slot, so the args
+          # are matched up with the predecessors left afterwards.
+          if dest.phi_count > 0
+            before = dest.real_predecessors.to_a
+            disconnect_without_fixup(dest)
+            order = remaining_phi_args(before, dest.real_predecessors.to_a)
+            dest.each_phi do |node|
+              args = node[2..-1]
+              node[2..-1] = order.map { |index| args[index] }
               if node.size == 3
                 node.replace([:assign, node[1], node[2]])
               end
             end
+            dest.settle_phis
+          else
+            disconnect_without_fixup(dest)
+          end
+        end
+
+        # The positions in the old predecessor list of each of the new
+        # predecessors. A block with parallel edges to dest appears once
+        # per edge, so each old position is used only once.
+        def remaining_phi_args(before, after)
+          used = []
+          after.map do |pred|
+            index = before.each_index.find { |i| !used[i] && before[i].equal?(pred) }
+            used[index] = true
+            index
           end
-          disconnect_without_fixup(dest)
         end
 
         # Formats the block all pretty-like for Graphviz. Horrible formatting for
@@ -31,6 +31,7 @@ module Laser
           else
             return_uncond_jump_instruct result
           end
+          @graph.add_edges(@pending_edges)
           
           @graph.prune_totally_useless_blocks
           @graph
@@ -768,6 +769,7 @@ module Laser
           @graph = ControlFlowGraph.new(@formals)
           @graph.root = @sexp
           @block_counter = 0
+          @pending_edges = []
           @enter = @graph.enter
           @exit = @graph.exit
           @temporary_counter = 0
@@ -847,7 +849,7 @@ module Laser
           body_block = create_block
           body_value, body_proc = create_block_temporary block_arg_bindings, block_sexp, @current_block
           call_instruct(body_value, :lexical_self=, self_instruct, raise: false, value: false)
-          @graph.add_edge(@current_block, body_block,
+          add_edge(@current_block, body_block,
               ControlFlowGraph::EDGE_BLOCK_TAKEN | ControlFlowGraph::EDGE_ABNORMAL)
           result = yield(body_value)
           after = @current_block  # new block caused by method call
@@ -860,9 +862,9 @@ module Laser
         
         def build_block_exit_block(body_block, after)
           build_block_with_jump(nil, body_block.name + '-Exit') do
-            @graph.add_edge(@current_block, body_block,
+            add_edge(@current_block, body_block,
                 RGL::ControlFlowGraph::EDGE_ABNORMAL | RGL::ControlFlowGraph::EDGE_BLOCK_TAKEN)
-            @graph.add_edge(@current_block, after)
+            add_edge(@current_block, after)
             add_potential_raise_edge(false)
           end
         end
@@ -916,7 +918,7 @@ module Laser
         def uncond_instruct(target, opts = {})
           opts = {jump_instruct: true, flags: RGL::ControlFlowGraph::EDGE_NORMAL}.merge(opts)
           add_instruction(:jump, target.name) if opts[:jump_instruct]
-          @graph.add_edge(@current_block, target, opts[:flags])
+          add_edge(@current_block, target, opts[:flags])
           start_block target
         end
         
@@ -926,8 +928,8 @@ module Laser
           if opts[:branch_instruct]
             add_instruction(:branch, val, true_block.name, false_block.name)
           end
-          @graph.add_edge(@current_block, true_block)
-          @graph.add_edge(@current_block, false_block)
+          add_edge(@current_block, true_block)
+          add_edge(@current_block, false_block)
         end
         
         # Performs a no-arg return.
@@ -1979,7 +1981,7 @@ module Laser
         # while creating a new block for the "natural" exit.
         def add_potential_raise_edge(add_success_branch = true)
           fail_block = create_block
-          @graph.add_edge(@current_block, fail_block, RGL::ControlFlowGraph::EDGE_ABNORMAL)
+          add_edge(@current_block, fail_block, RGL::ControlFlowGraph::EDGE_ABNORMAL)
           with_current_basic_block(fail_block) do
             observe_just_raised_exception
             uncond_instruct current_rescue, flags: RGL::ControlFlowGraph::EDGE_ABNORMAL
@@ -2435,8 +2437,14 @@ module Laser
           value ? create_temporary : nil
         end
         
+        # Edges are queued while building and added to the graph in one
+        # batch at the end of #build; nothing reads them before then.
+        def add_edge(from, to, flags = RGL::ControlFlowGraph::EDGE_NORMAL)
+          @pending_edges.push(from, to, flags)
+        end
+        
         def add_fake_edge(from, to)
-          @graph.add_edge(from, to, RGL::ControlFlowGraph::EDGE_FAKE)
+          add_edge(from, to, RGL::ControlFlowGraph::EDGE_FAKE)
         end
         
         # Returns the name of the current temporary.
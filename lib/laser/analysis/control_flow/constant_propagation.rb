@@ -16,18 +16,10 @@ module Laser
           opts = {fixed_methods: {}, initial_block: self.enter}.merge(opts)
           
           initialize_constant_propagation(opts)
-          visited = Set.new
-          worklist = Set.new
-          blocklist = Set[opts[:initial_block]]
-          while worklist.any? || blocklist.any?
-            while worklist.any?
-              constant_propagation_for_instruction(
-                  worklist.pop, blocklist, worklist, opts)
-            end
-            while blocklist.any?
-              constant_propagation_for_block(
-                  blocklist.pop, visited, blocklist, worklist, opts)
-            end
+          driver = Driver.new
+          driver.push_block(opts[:initial_block])
+          driver.run do |instruction|
+            constant_propagation_for_instruction(instruction, driver, opts)
           end
           teardown_constant_propagation
           @constants = find_remaining_constants
@@ -77,55 +69,29 @@ module Laser
           @cp_self_cells[instruction]
         end
 
-        # Simulates a block. As we know, phi nodes execute simultaneously
-        # and immediately upon block entry, so first we check phi nodes to
-        # see if they form a constant. This happens unconditionally, as
-        # phi nodes must be checked repeatedly.
-        #
-        # Then, if the block hasn't been visited before, simulate the normal
-        # instructions, and mark it so it is not visited again.
-        #
-        # Morgan, p.200
-        def constant_propagation_for_block(block, visited, blocklist, worklist, opts)
-          block.phi_nodes.each do |phi_node|
-            constant_propagation_for_instruction(
-                phi_node, blocklist, worklist, opts)
-          end
-          if visited.add?(block)
-            block.natural_instructions.each do |instruction|
-              constant_propagation_for_instruction(
-                  instruction, blocklist, worklist, opts)
-            end
-            if block.fall_through_block?
-              block.successors.each do |succ|
-                constant_propagation_consider_edge block, succ, blocklist
-              end
-            end
-          end
-        end
-        private :constant_propagation_for_block
-
-        def constant_propagation_for_instruction(instruction, blocklist, worklist, opts)
-          return if instruction.type != :phi && instruction.block.executed_predecessors.empty?
+        # Evaluates an instruction handed back by the driver. The driver
+        # simulates the blocks itself (Morgan, p.200), skipping instructions
+        # in blocks not yet known to execute and following jumps natively.
+        def constant_propagation_for_instruction(instruction, driver, opts)
           Laser.debug_p(instruction)
           block = instruction.block
           case instruction.type
           when :assign, :phi
             if constant_propagation_evaluate(instruction)
-              add_target_uses_to_worklist instruction, worklist
+              add_target_uses_to_worklist instruction, driver
             end
           when :call, :call_vararg, :super, :super_vararg
             changed, raised, raise_changed = constant_propagation_for_call(instruction, opts)
             if changed
               if instruction[1] && instruction[1].value != UNDEFINED
-                add_target_uses_to_worklist instruction, worklist
+                add_target_uses_to_worklist instruction, driver
               end
             end
             if raise_changed && instruction == block.instructions.last
               raise_capture_insn = instruction.block.exception_successors.first.instructions.first
               raise_capture_insn[1].bind!(VARYING)
               raise_capture_insn[1].inferred_type = instruction.raise_type
-              add_target_uses_to_worklist raise_capture_insn, worklist
+              add_target_uses_to_worklist raise_capture_insn, driver
             end
             if raised != instruction.raise_frequency && instruction == block.instructions.last
               instruction.raise_frequency = raised
@@ -136,14 +102,11 @@ module Laser
                            when Frequency::ALWAYS then block.abnormal_successors
                            end
               successors.each do |succ|
-                constant_propagation_consider_edge block, succ, blocklist
+                driver.consider_edge(block, succ)
               end
             end
           when :branch
-            constant_propagation_for_branch(instruction, blocklist)
-          when :jump, :raise, :return
-            succ = block.real_successors.first
-            constant_propagation_consider_edge block, succ, blocklist
+            constant_propagation_for_branch(instruction, driver)
           when :declare
             case instruction[1]
             when :expect_tuple_size
@@ -156,7 +119,7 @@ module Laser
           end
         end
 
-        def add_target_uses_to_worklist(instruction, worklist)
+        def add_target_uses_to_worklist(instruction, driver)
           uses = if instruction[0] == :call && instruction[2] == ClassRegistry['Laser#Magic'].binding &&
                     instruction[3] == :set_global
                    Scope::GlobalScope.lookup(instruction[4].value).uses
@@ -168,16 +131,16 @@ module Laser
                  else
                    instruction.explicit_targets.map(&:uses).inject(:|) || []
                  end
-          uses.each { |use| worklist.add(use) if use }
+          uses.each { |use| driver.push_instruction(use) if use }
         end
         
-        # Examines the branch for newly executable edges, and adds them to
-        # the blocklist.
-        def constant_propagation_for_branch(instruction, blocklist)
+        # Examines the branch for newly executable edges, and queues their
+        # destinations on the driver.
+        def constant_propagation_for_branch(instruction, driver)
           block = instruction.block
           executable_successors = constant_propagation_branch_successors(instruction)
           executable_successors.each do |succ|
-            constant_propagation_consider_edge block, succ, blocklist
+            driver.consider_edge(block, succ)
           end
         end
         
@@ -196,13 +159,6 @@ module Laser
           end
         end
 
-        def constant_propagation_consider_edge(block, succ, blocklist)
-          if !is_executable?(block, succ) && !is_fake?(block, succ)
-            add_flag(block, succ, ControlFlowGraph::EDGE_EXECUTABLE)
-            blocklist << succ
-          end
-        end
-
         def constant_propagation_for_call(instruction, cp_opts)
           target = instruction[1] || cp_cell_for(instruction)
           original = target.value
@@ -41,12 +41,10 @@ module Laser
           @formal_types = nil
           @block_type = nil
           @block_register = nil
-          @all_cached_variables = Set.new
-          @live = Hash.new { |hash, temp| hash[temp] = Set.new }
+          @all_cached_variables = TempSet.new
+          @live = nil
           @constants  = {}
-          @globals = Set.new
-          @name_stack = Hash.new { |hash, temp| hash[temp] = [] }
-          @name_count = Hash.new { |hash, temp| hash[temp] = 0 }
+          @globals = TempSet.new
           @formals = formal_arguments
           @yield_type = nil
           @yield_arity = nil
@@ -62,6 +60,9 @@ module Laser
         end
         
         def initialize_dup(source)
+          # copies the graph as it is outside any overlay being run on it.
+          overlay = source.entered_overlay
+          return overlay.suspend { initialize_dup(source) } if overlay
           @root = source.root
           @in_ssa = source.in_ssa
           @self_type = source.self_type
@@ -71,7 +72,6 @@ module Laser
           # our source data about temps (defs, uses, constants...) corresponds
           # the duplicated temps, we'll need a hash to look them up.
           temp_lookup = { Bootstrap::VISIBILITY_STACK => Bootstrap::VISIBILITY_STACK }
-          block_lookup = { source.enter => @enter, source.exit => @exit }
           insn_lookup = Hash.new
           # copy all vars defined in the body
           source.all_cached_variables.each do |k|
@@ -87,18 +87,11 @@ module Laser
             temp_lookup[formal] = formal.deep_dup
           end
 
-          new_blocks = source.vertices.reject { |v| TerminalBasicBlock === v }
-          new_blocks.map! do |block|
-            copy = block.duplicate_for_graph_copy(temp_lookup, insn_lookup)
-            block_lookup[block] = copy
-            copy
-          end
-          
-          new_blocks.each do |new_block|
-            add_vertex new_block
-          end
-          source.each_edge do |u, v|
-            add_edge(block_lookup[u], block_lookup[v], u.get_flags(v))
+          # copies blocks and edges natively; block_lookup maps ids to copies.
+          block_lookup = copy_topology(source)
+          source.each_vertex do |block|
+            next if TerminalBasicBlock === block
+            block.copy_instructions_for_graph_copy(block_lookup[block.id], temp_lookup, insn_lookup)
           end
           
           # computed stuff we shouldn't lose:
@@ -117,9 +110,7 @@ module Laser
             # no need to dup value, as these constants *MUST NOT* be mutated.
             @constants[temp_lookup[temp]] = value
           end
-          source.live.each do |temp, blocks|
-            @live[temp_lookup[temp]] = Set.new(blocks.map { |block| block_lookup[block] })
-          end
+          @live = source.live.translate(block_lookup, temp_lookup) if source.live
           # Tiny hope this speeds anything up
           temp_lookup.clear
           block_lookup.clear
@@ -153,6 +144,33 @@ module Laser
           end
         end
 
+        # What constant propagation computes beyond edge flags: each temp's
+        # value and type, each instruction's raise properties, the constants,
+        # and the block type they assume. Overlay swaps it in and out.
+        def speculative_state
+          temps = all_variables.map { |temp| [temp, temp.value, temp.inferred_type] }
+          instructions = []
+          vertices.each do |block|
+            block.instructions.each do |insn|
+              instructions << [insn, insn.raise_frequency, insn.raise_type]
+            end
+          end
+          [temps, instructions, @constants.dup, @block_type]
+        end
+
+        def restore_speculative_state(state)
+          temps, instructions, constants, @block_type = state
+          temps.each do |temp, value, type|
+            temp.bind! value
+            temp.inferred_type = type
+          end
+          instructions.each do |insn, frequency, type|
+            insn.raise_frequency = frequency
+            insn.raise_type = type
+          end
+          @constants = constants.dup
+        end
+
         def save_pretty_picture(fmt='png', dotfile='graph', params = {'shape' => 'box'})
           write_to_graphic_file(fmt, dotfile, params)
         end
@@ -162,7 +180,7 @@ module Laser
         end
 
         def raise_type
-          if !all_failure_postdominator || all_failure_postdominator.real_predecessors.empty?
+          if !all_failure_postdominator || !all_failure_postdominator.any_real_predecessor?
             Types::EMPTY
           else
             @final_exception.expr_type
@@ -216,47 +234,50 @@ module Laser
           @analyzed = true
 
           opts = DEFAULT_ANALYSIS_OPTS.merge(opts)
+          @stats_method = stats_method_name(opts[:method])
           # kill obvious dead code now.
-          perform_dead_code_discovery(true)
-          Laser.debug_puts('>>> Starting SSA Transformation <<<')
-          static_single_assignment_form unless @in_ssa
-          Laser.debug_puts('>>> Finished SSA Transformation <<<')
+          analysis_stage(:dead_code_discovery, 'Initial Dead Code Discovery') do
+            perform_dead_code_discovery(true)
+          end
+          analysis_stage(:ssa, 'SSA Transformation') do
+            static_single_assignment_form unless @in_ssa
+          end
           if @root.type == :program
-            Laser.debug_puts('>>> Starting Simulation <<<')
-            begin
-              simulate([], :mutation => true) if opts[:simulate]
-            rescue Simulation::NonDeterminismHappened => err
-              Laser.debug_puts('Note: Simulation was nondeterministic.')
-            rescue Simulation::SimulationNonterminationError => err
-              Laser.debug_puts('Note: Simulation was potentially nonterminating.')
+            analysis_stage(:simulation, 'Simulation') do
+              begin
+                simulate([], :mutation => true) if opts[:simulate]
+              rescue Simulation::NonDeterminismHappened => err
+                Laser.debug_puts('Note: Simulation was nondeterministic.')
+              rescue Simulation::SimulationNonterminationError => err
+                Laser.debug_puts('Note: Simulation was potentially nonterminating.')
+              end
             end
-            Laser.debug_puts('>>> Finished Simulation <<<')
           else
-            Laser.debug_puts('>>> Starting CP <<<')
-            perform_constant_propagation(opts)
-            Laser.debug_puts('>>> Finished CP <<<')
+            analysis_stage(:constant_propagation, 'CP') do
+              perform_constant_propagation(opts)
+            end
             if opts[:optimize]
-              Laser.debug_puts('>>> Killing Unexecuted Edges <<<')
-              kill_unexecuted_edges
-              Laser.debug_puts('>>> Finished Killing Unexecuted Edges <<<')
-              Laser.debug_puts('>>> Pruning Totally Useless Blocks <<<')
-              prune_totally_useless_blocks
-              Laser.debug_puts('>>> Finished Pruning Totally Useless Blocks <<<')
-              Laser.debug_puts('>>> Dead Code Discovery <<<')
-              perform_dead_code_discovery
-              Laser.debug_puts('>>> Finished Dead Code Discovery <<<')
-              Laser.debug_puts('>>> Adding Unused Variable Warnings <<<')
-              add_unused_variable_warnings
-              Laser.debug_puts('>>> Finished Adding Unused Variable Warnings <<<')
+              analysis_stage(:kill_unexecuted_edges, 'Killing Unexecuted Edges') do
+                kill_unexecuted_edges
+              end
+              analysis_stage(:prune_useless_blocks, 'Pruning Totally Useless Blocks') do
+                prune_totally_useless_blocks
+              end
+              analysis_stage(:dead_code_discovery, 'Dead Code Discovery') do
+                perform_dead_code_discovery
+              end
+              analysis_stage(:unused_variables, 'Adding Unused Variable Warnings') do
+                add_unused_variable_warnings
+              end
 
               if @root.type != :program
-                Laser.debug_puts('>>> Determining Yield Properties <<<')
-                find_yield_properties(opts)
-                Laser.debug_puts('>>> Finished Determining Yield Properties <<<')
+                analysis_stage(:yield_properties, 'Determining Yield Properties') do
+                  find_yield_properties(opts)
+                end
+              end
+              analysis_stage(:raise_properties, 'Determining Raise Properties') do
+                find_raise_properties
               end
-              Laser.debug_puts('>>> Determining Raise Properties <<<')
-              find_raise_properties
-              Laser.debug_puts('>>> Finished Determining Raise Properties <<<')
             end
           end
         end
@@ -273,7 +294,7 @@ module Laser
         def all_variables
           return @all_cached_variables unless @all_cached_variables.empty?
           return @all_variables if @all_variables
-          result = Set.new
+          result = TempSet.new
           vertices.each do |vert|
             vert.variables.each do |var|
               result << var
@@ -302,30 +323,19 @@ module Laser
           vertex_with_name(FAILURE_POSTDOMINATOR_NAME)
         end
         
-        # Yields reachable vertices via depth-first-search on real edges
-        def reachable_vertices
-          vertices = Set[]
-          worklist = Set[self.enter]
-          while worklist.any?
-            block = worklist.pop
-            yield block if block_given?
-            block.real_successors.each do |succ|
-              worklist.add(succ) if vertices.add?(succ)
-            end
-          end
-          vertices
+        # Yields reachable vertices in reverse post-order on real edges. The
+        # order is computed natively and cached until the graph changes.
+        # Returns them as a BlockSet.
+        def reachable_vertices(&blk)
+          reverse_post_order.each(&blk) if blk
+          BlockSet.new(self, reverse_post_order)
         end
         
         # Computes the variables reachable by DFSing the start node.
         # This excludes variables defined in dead code.
-        def reachable_variables(block = @enter, visited = Set.new)
-          visited << block
-          block.real_successors.inject(block.variables) do |cur, succ|
-            if visited.include?(succ)
-              cur
-            else
-              cur | reachable_variables(succ, visited)
-            end
+        def reachable_variables
+          reverse_post_order.inject(TempSet.new) do |cur, block|
+            cur.merge(block.variables)
           end
         end
 
@@ -350,25 +360,26 @@ module Laser
           end
         end
 
-        # Marks all edges that are not executable as fake edges. That way, the
-        # postdominance of Exit is preserved, but dead code analysis will ignore
-        # them.
-        def kill_unexecuted_edges(remove=false)
-          killable = Set.new
-          each_edge do |u, v|
-            if !(is_executable?(u, v) || is_fake?(u, v))
-              killable << [u, v]
-            end
-          end
-          killable.each do |u, v|
-            if remove
-              remove_edge(u, v)
-            else
-              u.add_flag(v, EDGE_FAKE)
-            end
-          end
+       private
+
+        # Runs one stage of analyze, timed by Stats against this graph's
+        # file and method.
+        def analysis_stage(stage, description)
+          Laser.debug_puts(">>> Starting #{description} <<<")
+          result = Stats.time(stage, @root.file_name, @stats_method) { yield }
+          Laser.debug_puts(">>> Finished #{description} <<<")
+          result
         end
 
+        def stats_method_name(method)
+          if method
+            "#{method.owner.name}##{method.name}"
+          elsif @root.type == :program
+            '(main)'
+          else
+            '(block)'
+          end
+        end
       end
     end
   end
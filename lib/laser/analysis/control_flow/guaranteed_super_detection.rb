@@ -2,16 +2,18 @@ module Laser
   module Analysis
     module ControlFlow
       module GuaranteedSuperDetection
+        # Every successful return passes through a super call when a block
+        # calling super dominates the return postdominator, so this walks
+        # its dominators up the native tree.
         def guaranteed_super_on_success?
-          tree = dominator_tree
-          success_block = tree[return_postdominator]
-          check_block = success_block
+          dominator_tree
+          check_block = return_postdominator
           while check_block
             has_super = check_block.instructions.any? do |insn|
               insn.type == :super || insn.type == :super_vararg
             end
             return true if has_super
-            check_block = check_block.successors.first
+            check_block = check_block.idom
           end
           false
         end
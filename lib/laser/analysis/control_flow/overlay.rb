@@ -0,0 +1,41 @@
+module Laser
+  module Analysis
+    module ControlFlow
+      # A what-if layer over a ControlFlowGraph, for running constant
+      # propagation under other assumptions without copying the graph. The
+      # overlay shares the graph's blocks, edges and instructions. Its edge
+      # flags are layered natively; the rest of what constant propagation
+      # computes (see ControlFlowGraph#speculative_state) is swapped here.
+      class Overlay
+        # Yields the graph as the overlay sees it, then puts the graph back.
+        # Later runs continue from where the last one left off.
+        def run
+          @base = graph.speculative_state
+          enter
+          graph.restore_speculative_state(@state) if @state
+          begin
+            yield graph
+          ensure
+            @state = graph.speculative_state
+            graph.restore_speculative_state(@base)
+            @base = nil
+            leave
+          end
+        end
+
+        # Yields with the graph as it is outside the overlay, during a run.
+        def suspend
+          state = graph.speculative_state if @base
+          graph.restore_speculative_state(@base) if @base
+          leave
+          begin
+            yield
+          ensure
+            enter
+            graph.restore_speculative_state(state) if state
+          end
+        end
+      end
+    end
+  end
+end
@@ -11,7 +11,7 @@ module Laser
         # Finds whether the method raises always, never, or sometimes.
         def find_raise_frequency
           fail_block = exception_postdominator
-          if fail_block.nil? || fail_block.real_predecessors.empty?
+          if fail_block.nil? || !fail_block.any_real_predecessor?
             @raise_frequency = Frequency::NEVER
           elsif (@exit.normal_predecessors & @exit.real_predecessors).empty?
             @raise_frequency = Frequency::ALWAYS
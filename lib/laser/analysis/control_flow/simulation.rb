@@ -19,7 +19,16 @@ module Laser
             @error = error
           end
         end
+        # Steps outside loops across a simulation and the simulations it
+        # starts; steps per entry into each loop, counting those of loops
+        # inside it; and steps in loops, shared by a simulation and all the
+        # simulations it starts.
         MAX_SIMULATION_BLOCKS = 100_000
+        MAX_SIMULATION_LOOP_STEPS = 100_000
+        MAX_SIMULATION_LOOP_BLOCKS = 1_000_000
+        # The steps in loops left to a simulation and those it starts. It is
+        # passed down by reference, so nested simulations draw on one count.
+        LoopBudget = Struct.new(:remaining)
         DEFAULT_SIMULATION_OPTS =
             {on_raise: :annotate, invocation_sites: Hash.new { |h, k| h[k] = Set.new },
              invocation_counts: Hash.new do |h1, block|
@@ -32,12 +41,14 @@ module Laser
         def simulate(formal_vals=[], opts={})
           opts = DEFAULT_SIMULATION_OPTS.merge(opts)
           opts[:formals] = formal_vals
+          opts[:loop_budget] ||= LoopBudget.new(MAX_SIMULATION_LOOP_BLOCKS)
           clear_analyses
           current_block = opts[:start_block] || @enter
           previous_block = nil
+          loop_steps = Hash.new(0).compare_by_identity
           begin
             loop do
-              simulate_take_step(opts)
+              simulate_take_step(current_block, previous_block, loop_steps, opts)
               from, next_block = simulate_block(current_block,
                   opts.merge(previous_block: previous_block, current_block: current_block))
               from.add_flag(next_block, ControlFlowGraph::EDGE_EXECUTABLE)
@@ -73,10 +84,32 @@ module Laser
           end
         end
         
-        def simulate_take_step(opts)
-          if (opts[:remaining_blocks] -= 1) <= 0
+        # Charges a step in a loop to every loop holding the block, and to
+        # the budget for steps in loops; any other step is charged to the
+        # budget outside loops. A loop's count starts over each time it is
+        # entered other than by a back edge. A loop that runs out of steps
+        # is given up on, as nondeterminism is, so constant propagation
+        # takes over from there.
+        def simulate_take_step(block, previous_block, loop_steps, opts)
+          header = block.loop_header
+          if header.nil?
+            if (opts[:remaining_blocks] -= 1) <= 0
+              raise SimulationNonterminationError.new('Simulation failed to terminate')
+            end
+            return
+          end
+          if (opts[:loop_budget].remaining -= 1) <= 0
             raise SimulationNonterminationError.new('Simulation failed to terminate')
           end
+          if block.equal?(header) && !(previous_block && previous_block.is_back_edge?(block))
+            loop_steps[header] = 0
+          end
+          while header
+            if (loop_steps[header] += 1) > MAX_SIMULATION_LOOP_STEPS
+              raise NonDeterminismHappened.new("Loop at #{header.name} ran over #{MAX_SIMULATION_LOOP_STEPS} steps")
+            end
+            header = header.outer_loop_header
+          end
         end
         
         def simulate_block(block, opts)
@@ -84,11 +117,12 @@ module Laser
           
           Laser.debug_puts "Entering block #{block.name}"
           # phi nodes always go first
-          block.phi_nodes.each do |node|
+          block.each_phi do |node|
             simulate_deterministic_phi_node(node, opts)
           end
-          block.natural_instructions[0..-2].each do |insn|
-            simulate_instruction(insn, opts)
+          exit_insn = block.instructions.last
+          block.each_natural_instruction do |insn|
+            simulate_instruction(insn, opts) unless insn.equal?(exit_insn)
           end
           if block.instructions.empty?
             [opts[:current_block], block.real_successors.first]
@@ -2,16 +2,12 @@ module Laser
   module Analysis
     module ControlFlow
       module UnreachabilityAnalysis
-        # Dead Code Discovery: O(|V| + |E|)!
+        # Dead Code Discovery: O(|V| + |E|)! Reachability is computed natively
+        # (see ControlFlowGraph#unreachable_vertices); only the AST marking
+        # happens here.
         IGNORED_DEAD_CODE_NODES = [:@ident, :@op, :void_stmt]
-        def unreachable_vertices(dfst = depth_first_spanning_tree(self.enter))
-          vertices - dfst.vertices
-        end
-        
         def perform_dead_code_discovery(delete_dead=false)
-          dfst = depth_first_spanning_tree(self.enter)
-
-          dead_verts = unreachable_vertices(dfst)
+          dead_verts = unreachable_vertices
 
           # then, go over all code in dead blocks, and mark potentially dead
           # ast nodes.
@@ -25,7 +21,7 @@ module Laser
           #
           # at most |V| nodes will have cur.reachable = true set.
           # at most O(V) instructions will be visited total.
-          dfst.each_vertex do |blk|
+          each_reverse_post_order do |blk|
             blk.instructions.each do |ins|
               cur = ins.node
               while cur
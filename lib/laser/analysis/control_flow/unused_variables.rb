@@ -48,10 +48,11 @@ module Laser
         # N = number of vars
         # O(N)
         def unused_variables
-          worklist = Set.new(simple_unused())
+          simple = simple_unused
+          worklist = TempSet.new(simple, simple)
           Laser.debug_puts('>>> Finished finding simple unused vars <<<')
-          all_unused = Set.new
-          while worklist.any?
+          all_unused = TempSet.new(nil, worklist)
+          until worklist.empty?
             var = worklist.pop
             if all_unused.add?(var)
               definition = var.definition
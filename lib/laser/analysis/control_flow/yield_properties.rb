@@ -12,32 +12,39 @@ module Laser
           magic_method_to_fix  = ClassRegistry['Laser#Magic'].singleton_class.
               instance_method(:current_block)
 
+          # Each case runs in an overlay, which shares this graph and puts
+          # it back as it was once the case is decided.
+
           # Calculate the "no block provided" case
-          without_yield = dup
-          without_yield.bind_block_type(Types::NILCLASS)
-          without_yield.perform_constant_propagation(opts.merge(
-              fixed_methods: { kernel_method_to_fix => false,
-                               proc_method_to_fix   => nil }))
-          without_yield.kill_unexecuted_edges
+          yields_without_block = has_return_pd = nil
+          Overlay.new(self).run do |without_yield|
+            without_yield.bind_block_type(Types::NILCLASS)
+            without_yield.perform_constant_propagation(opts.merge(
+                fixed_methods: { kernel_method_to_fix => false,
+                                 proc_method_to_fix   => nil }))
+            without_yield.kill_unexecuted_edges
 
-          weak_without_calls = without_yield.potential_block_calls(opts)
-          yield_pd = without_yield.yield_fail_postdominator
-          has_yield_pd = yield_pd && yield_pd.real_predecessors.size > 0
-          return_pd = without_yield.return_postdominator
-          has_return_pd = return_pd && return_pd.real_predecessors.size > 0
-          yields_without_block = has_yield_pd || weak_without_calls.size > 0
+            weak_without_calls = without_yield.potential_block_calls(opts)
+            yield_pd = without_yield.yield_fail_postdominator
+            has_yield_pd = yield_pd && yield_pd.any_real_predecessor?
+            return_pd = without_yield.return_postdominator
+            has_return_pd = return_pd && return_pd.any_real_predecessor?
+            yields_without_block = has_yield_pd || weak_without_calls.size > 0
+          end
 
           # Calculate the "has block provided" case
-          with_yield = dup
-          with_yield.bind_block_type(Types::PROC)
-          fake_block = proc { |*args| }
-          with_yield.perform_constant_propagation(opts.merge(
-              fixed_methods: { kernel_method_to_fix => true,
-                               magic_method_to_fix  => fake_block,
-                               proc_method_to_fix   => fake_block}))
-          with_yield.kill_unexecuted_edges
-          weak_with_calls = with_yield.potential_block_calls(fake_block, opts)
-          yields_with_block = weak_with_calls.size > 0
+          yields_with_block = weak_with_calls = nil
+          Overlay.new(self).run do |with_yield|
+            with_yield.bind_block_type(Types::PROC)
+            fake_block = proc { |*args| }
+            with_yield.perform_constant_propagation(opts.merge(
+                fixed_methods: { kernel_method_to_fix => true,
+                                 magic_method_to_fix  => fake_block,
+                                 proc_method_to_fix   => fake_block}))
+            with_yield.kill_unexecuted_edges
+            weak_with_calls = with_yield.potential_block_calls(fake_block, opts)
+            yields_with_block = weak_with_calls.size > 0
+          end
           # if the mere difference in block presence results in no exit path, then
           # we consider this evidence of failure due to lack of block.
           yields_without_block = true if yields_with_block && !has_return_pd
@@ -70,7 +77,7 @@ module Laser
           proc_new_calls = find_method_calls(
               ClassRegistry['Proc'].singleton_class.instance_method(:new), opts)
           registers = proc_new_calls.map { |insn| insn[1] }
-          initial_aliases = Set.new(registers)
+          initial_aliases = TempSet.new(registers)
           initial_aliases.add(block_register)
         end
 
@@ -0,0 +1,68 @@
+require 'digest/sha2'
+require 'fileutils'
+module Laser
+  module Analysis
+    # Caches parse trees on disk, keyed by a digest of the source text and by
+    # the Laser, RipperPlus, and Ruby versions, so files that haven't changed since the
+    # last run aren't parsed again. Nothing is cached unless a directory is
+    # set, with --cache-dir or LASER_CACHE_DIR.
+    #
+    # Only the RipperPlus output is cached: it is plain data, while the
+    # annotated Sexp and the CFGs built from it hold scopes and bindings
+    # that each run must create for itself.
+    module ParseCache
+      def self.directory
+        SETTINGS[:cache_dir]
+      end
+
+      # Parses the text as RipperPlus.sexp does, through the cache if one
+      # is set.
+      def self.sexp(text)
+        return RipperPlus.sexp(text) unless directory
+        path = entry_path(text)
+        if (tree = read_entry(path))
+          tree
+        elsif (tree = RipperPlus.sexp(text))
+          write_entry(path, tree)
+        end
+      end
+
+      def self.entry_path(text)
+        digest = Digest::SHA256.hexdigest(text)
+        version = "#{Laser::Version::STRING}-#{parser_version}-#{RUBY_VERSION}"
+        File.join(directory, version, digest[0, 2], digest[2..-1])
+      end
+
+      # The version of RipperPlus, whose output is what gets cached.
+      def self.parser_version
+        @parser_version ||= if (spec = Gem.loaded_specs['ripper-plus'])
+                            then spec.version.to_s
+                            elsif defined?(RipperPlus::Version::STRING)
+                            then RipperPlus::Version::STRING
+                            else 'unknown'
+                            end
+      end
+
+      # A missing, unreadable, or truncated entry is a miss.
+      def self.read_entry(path)
+        File.open(path, 'rb') { |file| Marshal.load(file) }
+      rescue StandardError
+        nil
+      end
+
+      # Writes to a temporary file first and renames it into place, so a
+      # concurrent run never reads half an entry. Failing to write only
+      # costs the next run a parse.
+      def self.write_entry(path, tree)
+        temp = "#{path}.#{Process.pid}.tmp"
+        FileUtils.mkdir_p(File.dirname(path))
+        File.open(temp, 'wb') { |file| Marshal.dump(tree, file) }
+        File.rename(temp, path)
+        tree
+      rescue StandardError
+        File.unlink(temp) rescue nil
+        tree
+      end
+    end
+  end
+end
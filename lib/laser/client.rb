@@ -0,0 +1,42 @@
+require 'socket'
+require 'json'
+require 'tmpdir'
+module Laser
+  # The thin client of laser --server. It sends its arguments, working
+  # directory, and standard input (if --stdin is given) to the server, then
+  # prints what the run printed. It loads nothing else of Laser, so it
+  # starts as fast as Ruby does.
+  class Client
+    # The socket the server listens on unless told otherwise.
+    def self.default_path
+      ENV['LASER_SOCKET'] || File.join(Dir.tmpdir, "laser-#{Process.uid}.sock")
+    end
+
+    attr_reader :path
+
+    def initialize(path = Client.default_path)
+      @path = path
+    end
+
+    # Runs laser with the given arguments on the server.
+    #
+    # @return [Integer] the exit status of the run
+    def run(argv, stdin = $stdin)
+      request = {argv: argv, cwd: Dir.pwd}
+      request[:stdin] = stdin.read if reads_stdin?(argv)
+      response = UNIXSocket.open(@path) do |socket|
+        socket.puts(JSON.generate(request))
+        JSON.parse(socket.read)
+      end
+      $stdout.write(response['stdout'])
+      $stderr.write(response['stderr'])
+      response['status']
+    end
+
+   private
+
+    def reads_stdin?(argv)
+      argv.include?('--stdin') || argv.include?('-s')
+    end
+  end
+end
@@ -10,14 +10,17 @@ module Laser
 
     def run
       settings, files = collect_options_and_arguments
-      # parse_forest: Array<Array<String, Sexp>>
-      parse_forest = files.zip(files.map { |file| Ripper.sexp(read_file(file))})
+      return Server.new(settings[:socket] || Client.default_path).run if settings[:server]
       settings[:__using__] = warnings_to_consider
       settings[:__fix__] = warnings_to_fix
       scanner = Scanner.new(settings)
-      warnings = collect_warnings(files, scanner)
+      warnings = if parallel?(settings, files)
+                 then WorkerPool.new(settings[:jobs]).scan(files, scanner)
+                 else collect_warnings(files, scanner)
+                 end
       display_warnings(warnings, settings) if settings[:display]
       print_modules if settings[:"list-modules"]
+      Stats.write(settings[:stats]) if settings[:stats]
     end
 
     def collect_options_and_arguments
@@ -39,6 +42,10 @@ module Laser
     #   that will be the only warnings run. The names should be whitespace-delimited.
     # @option settings :"line-length" (Integer) a maximum line length to
     #   generate a warning for. A common choice is 80/83.
+    # @option settings :"cache-dir" (String) a directory in which to cache
+    #   parse trees between runs.
+    # @option settings :stats (String) a path to write analysis timings and
+    #   counters to as JSON, or '-' for standard output.
     def handle_global_options(settings)
       if settings[:"line-length"]
         @using << Laser.LineLengthWarning(settings[:"line-length"])
@@ -54,6 +61,10 @@ module Laser
         require 'profile'
         SETTINGS[:profile] = true
       end
+      Stats.enable! if settings[:stats]
+      if settings[:"cache-dir"]
+        Laser::SETTINGS[:cache_dir] = settings[:"cache-dir"]
+      end
       if settings[:include]
         Laser::SETTINGS[:load_path] = settings[:include].reverse
       end
@@ -75,6 +86,11 @@ module Laser
         opt :stdin, 'Read Ruby code from standard input', short: '-s'
         opt :'list-modules', 'Print the discovered, loaded modules'
         opt :profile, 'Run the profiler during execution'
+        opt :'cache-dir', 'Cache parse trees in the given directory between runs', type: :string
+        opt :server, 'Serve runs from laser-client over a Unix socket'
+        opt :socket, 'The socket for --server (default: $LASER_SOCKET, or one in the temp directory)', type: :string
+        opt :jobs, 'Scan the files in N forked worker processes', short: '-j', type: :int
+        opt :stats, 'Write stage timings and CFG counters as JSON to the given file (- for stdout)', type: :string
         opt :include, 'specify $LOAD_PATH directory (may be used more than once)', short: '-I', multi: true
         opt :S, 'look for scripts using PATH environment variable', short: '-S'
         warning_opts.each { |warning| opt(*warning) }
@@ -172,6 +188,13 @@ module Laser
       full_list.flatten
     end
 
+    # Should the files be scanned by a WorkerPool? Fixing rewrites files as
+    # they are scanned, so it stays in this process.
+    def parallel?(settings, files)
+      settings[:jobs] && settings[:jobs] > 1 && files.size > 1 &&
+        !settings[:fix] && !settings[:stdin]
+    end
+
     # Displays warnings using user-provided settings.
     #
     # @param [Array<Warning>] warnings the warnings generated by the input
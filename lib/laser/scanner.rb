@@ -43,6 +43,15 @@ module Laser
     # @return [Array[Laser::Warnings]] the warnings generated by the code.
     #   If the code is clean, an empty array is returned.
     def scan(text, filename='(none)')
+      scan_file(text, filename) + unused_method_warnings
+    end
+
+    # Scans the text for the warnings found in it alone, leaving out the
+    # ones that depend on every file having been analyzed.
+    #
+    # @param [String] text the input ruby file to scan
+    # @return [Array[Laser::Warnings]] the warnings generated by the code.
+    def scan_file(text, filename='(none)')
       warnings = scan_for_file_warnings(text, filename)
       text = filter_fixable(warnings).inject(text) do |text, warning|
         warning.fix(text)
@@ -52,7 +61,6 @@ module Laser
           warnings.concat process_line(line, number + 1, filename)
         end
       end
-      warnings += unused_method_warnings
       warnings
     end
 
@@ -115,13 +123,17 @@ module Laser
     end
 
     def unused_method_warnings
-      Analysis::MethodAnalysis.unused_methods.map do |method| 
-        warning = UncalledMethodWarning.new(method.proc.ast_node.file_name, '', method: method)
-        warning.line_number = method.proc.line_number
-        warning
+      Analysis::MethodAnalysis.unused_methods.map do |method|
+        uncalled_method_warning(method)
       end
     end
 
+    def uncalled_method_warning(method)
+      warning = UncalledMethodWarning.new(method.proc.ast_node.file_name, '', method: method)
+      warning.line_number = method.proc.line_number
+      warning
+    end
+
     def method_expectation_warnings
       
     end
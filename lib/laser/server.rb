@@ -0,0 +1,111 @@
+require 'socket'
+require 'json'
+require 'tempfile'
+module Laser
+  # Keeps a bootstrapped Laser resident and runs laser for clients over a
+  # Unix socket, so they skip loading and analyzing the standard library
+  # model on every run. See Laser::Client for the other end.
+  #
+  # Each request runs in a child forked from the server. Analysis defines
+  # the user's classes and methods in the global scope as it goes, so
+  # instead of trying to undo that, every child starts from the same
+  # bootstrapped snapshot, sharing its memory copy-on-write, and takes its
+  # changes with it when it exits.
+  #
+  # Requests are one line of JSON: argv, cwd, and optionally stdin.
+  # Responses are one JSON document: stdout, stderr, and status.
+  class Server
+    attr_reader :path
+
+    def initialize(path = Client.default_path)
+      @path = path
+    end
+
+    # Serves requests until interrupted, then removes the socket.
+    def run
+      listen
+      [:INT, :TERM].each { |signal| trap(signal) { raise Interrupt } }
+      # Compacts the bootstrapped heap once, so children share more of it.
+      Process.warmup if Process.respond_to?(:warmup)
+      $stderr.puts "laser: serving on #{@path}"
+      loop { serve(@server.accept) }
+    rescue Interrupt
+      nil
+    ensure
+      close
+    end
+
+    def listen
+      remove_stale_socket
+      old_umask = File.umask(0077)
+      @server = UNIXServer.new(@path)
+    ensure
+      File.umask(old_umask) if old_umask
+    end
+
+    def close
+      if @server
+        @server.close
+        File.unlink(@path) if File.socket?(@path)
+        @server = nil
+      end
+    end
+
+    # Answers one client from a forked child and returns at once.
+    def serve(socket)
+      pid = fork do
+        begin
+          @server.close if @server
+          request = JSON.parse(socket.gets)
+          socket.write(JSON.generate(respond(request)))
+        rescue StandardError
+          # The client went away or sent garbage: nobody to answer.
+        ensure
+          exit!(0)
+        end
+      end
+      Process.detach(pid)
+    ensure
+      socket.close
+    end
+
+   private
+
+    # Runs the request in this (child) process as bin/laser would in the
+    # client's directory, capturing everything it prints.
+    def respond(request)
+      Dir.chdir(request['cwd']) if request['cwd']
+      input, output, errors = %w(in out err).map { |name| Tempfile.new("laser-#{name}") }
+      input.write(request['stdin'] || '')
+      input.rewind
+      STDIN.reopen(input)
+      STDOUT.reopen(output)
+      STDERR.reopen(errors)
+      status = begin
+        Runner.new(request['argv'] || []).run
+        0
+      rescue SystemExit => err
+        err.status
+      rescue StandardError => err
+        STDERR.puts "#{err.class}: #{err.message}"
+        1
+      end
+      STDOUT.flush
+      STDERR.flush
+      {stdout: File.read(output.path), stderr: File.read(errors.path), status: status}
+    end
+
+    # A socket left behind by a server that died is removed; one that
+    # still answers belongs to a running server.
+    def remove_stale_socket
+      return unless File.socket?(@path)
+      begin
+        UNIXSocket.open(@path).close
+      rescue SystemCallError
+        File.unlink(@path)
+        return
+      end
+      raise Errno::EADDRINUSE, "a laser server is already listening on #{@path}"
+    end
+  end
+end
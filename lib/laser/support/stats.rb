@@ -0,0 +1,129 @@
+module Laser
+  # Collects timings of the analysis stages, aggregated by stage, file, and
+  # method, along with the native CFG counters, for laser --stats.
+  #
+  # Stage times are exclusive: time spent in a stage nested inside another,
+  # such as a method analyzed lazily during simulation, is charged to the
+  # inner stage only. Until enable! is called, Stats.time just yields.
+  module Stats
+    @enabled = false
+
+    def self.enabled?
+      @enabled
+    end
+
+    def self.enable!
+      @enabled = true
+      reset
+    end
+
+    def self.disable!
+      @enabled = false
+    end
+
+    def self.reset
+      @frames = []
+      @stages = Hash.new { |hash, stage| hash[stage] = {calls: 0, time: 0.0} }
+      @files = Hash.new { |hash, file| hash[file] = Hash.new(0.0) }
+      @methods = Hash.new { |hash, method| hash[method] = Hash.new(0.0) }
+      @native = Hash.new(0)
+      @start = clock
+      native_module.reset_native_counters if native_module
+    end
+
+    def self.clock
+      Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    end
+
+    # Times the block as the given stage of analyzing the file and method,
+    # either of which may be nil. Returns the block's value.
+    def self.time(stage, file = nil, method = nil)
+      return yield unless @enabled
+      frame = [clock, 0.0]
+      @frames.push(frame)
+      yield
+    ensure
+      record(stage, file, method, frame) if frame
+    end
+
+    def self.record(stage, file, method, frame)
+      @frames.pop
+      elapsed = clock - frame[0]
+      @frames.last[1] += elapsed if @frames.any?
+      exclusive = elapsed - frame[1]
+      @stages[stage][:calls] += 1
+      @stages[stage][:time] += exclusive
+      @files[file][stage] += exclusive if file
+      @methods[method][stage] += exclusive if method
+    end
+    private_class_method :record
+
+    def self.to_h
+      {wall_time: clock - @start,
+       stages: @stages,
+       files: totals(@files),
+       methods: totals(@methods),
+       native: native_totals}
+    end
+
+    def self.to_json(*args)
+      to_h.to_json(*args)
+    end
+
+    # The tables collected so far, in a form that can be Marshaled, for a
+    # worker of laser --jobs to send to its parent.
+    def self.snapshot
+      {stages: Hash[@stages], files: Hash[@files], methods: Hash[@methods],
+       native: native_module ? native_module.native_counters : {}}
+    end
+
+    # Adds a worker's snapshot to the tables. Wall time stays the parent's.
+    def self.merge(snapshot)
+      snapshot[:stages].each do |stage, totals|
+        @stages[stage][:calls] += totals[:calls]
+        @stages[stage][:time] += totals[:time]
+      end
+      [[@files, snapshot[:files]], [@methods, snapshot[:methods]]].each do |table, other|
+        other.each do |key, stages|
+          stages.each { |stage, time| table[key][stage] += time }
+        end
+      end
+      snapshot[:native].each { |counter, count| @native[counter] += count }
+    end
+
+    # Writes the collected statistics as JSON to the path, or to stdout
+    # if the path is '-'.
+    def self.write(path)
+      require 'json'
+      output = JSON.pretty_generate(to_h)
+      if path == '-'
+        puts output
+      else
+        File.open(path, 'w') { |file| file.puts(output) }
+      end
+    end
+
+    def self.totals(table)
+      table.each_with_object({}) do |(key, stages), result|
+        result[key] = {total: stages.values.inject(0.0, :+), stages: stages}
+      end
+    end
+    private_class_method :totals
+
+    # This process's native counters, plus those merged from workers.
+    def self.native_totals
+      counters = native_module ? native_module.native_counters : {}
+      return counters if @native.empty?
+      counters.merge(@native) { |counter, mine, theirs| mine + theirs }
+    end
+    private_class_method :native_totals
+
+    # The native CFG layer, once its extension has been loaded.
+    def self.native_module
+      defined?(Analysis::ControlFlow.native_counters) && Analysis::ControlFlow
+    end
+    private_class_method :native_module
+
+    reset
+  end
+end
@@ -13,12 +13,19 @@ module RGL
     # Computes the depth first spanning tree of the CFG, and
     # also attaches the depth-first ordering to the basic blocks
     # in the CFG.
-    # O(|V| + |E|), just like DFS.
+    # O(|V| + |E|), just like DFS. From a ControlFlowGraph's entry, the
+    # tree is read off the cached native traversal (see #dfs_parent).
     def depth_first_spanning_tree(start_node)
       raise ArgumentError unless vertices.include?(start_node)
       tree = DirectedAdjacencyGraph.new
-      visited = Set.new
-      build_dfst(tree, start_node, visited)
+      if respond_to?(:reverse_post_order) && start_node.equal?(enter)
+        reverse_post_order.each do |block|
+          tree.add_edge(block.dfs_parent, block) if block.dfs_parent
+        end
+      else
+        visited = Set.new
+        build_dfst(tree, start_node, visited)
+      end
       tree
     end
     
@@ -0,0 +1,138 @@
+require 'set'
+module Laser
+  # Scans files in forked workers for laser --jobs N. The workers are forked
+  # once Laser has loaded, so they share the bootstrapped standard library
+  # model copy-on-write instead of each building their own.
+  #
+  # Files are dealt out to the workers in turn. Each worker scans its shard
+  # with the runner's scanner, leaving out the warnings that need every file
+  # analyzed, and writes one Marshaled message per file to its pipe as it
+  # goes. Warnings travel as Records, which keep only what is displayed.
+  #
+  # No worker sees all the files, so the parent does the cross-file passes.
+  # Each worker reports the user methods it defined and the ones its calls
+  # resolved to, under their owner#name, and the parent warns of a method
+  # only if no worker called it. As in a single process, a call resolves
+  # only to a method whose file its worker has loaded, by scanning it or
+  # through a require.
+  class WorkerPool
+    # What the parent keeps of a warning.
+    Record = Struct.new(:file, :line_number, :name, :severity, :desc, :fixable) do
+      def self.from(warning)
+        new(warning.file, warning.line_number, warning.name, warning.severity,
+            warning.desc, warning.fixable?)
+      end
+
+      def fixable?
+        fixable
+      end
+    end
+
+    attr_reader :jobs
+
+    def initialize(jobs)
+      @jobs = jobs
+    end
+
+    # Scans the files in the workers.
+    #
+    # @param [Array<String>] files the files to scan
+    # @param [Scanner] scanner the scanner each worker uses
+    # @return [Array<Record>] the warnings, ordered by file, followed by
+    #   those of the cross-file passes.
+    def scan(files, scanner)
+      results = Array.new(files.size)
+      defined, called = {}, Set[]
+      shards = Array.new([@jobs, files.size].min) { [] }
+      files.each_with_index { |file, index| shards[index % shards.size] << index }
+      workers = shards.map { |shard| spawn(files, shard, scanner) }
+      until workers.empty?
+        ready, _ = IO.select(workers.map(&:first))
+        ready.each do |pipe|
+          begin
+            kind, *payload = Marshal.load(pipe)
+          rescue EOFError
+            pipe.close
+            pid = workers.assoc(pipe).last
+            workers.delete_if { |worker| worker.first == pipe }
+            Process.wait(pid)
+            raise "laser: a worker exited with status #{$?.exitstatus}" unless $?.success?
+            next
+          end
+          case kind
+          when :file then results[payload[0]] = payload[1]
+          when :methods
+            defined.merge!(payload[0]) { |_, mine, theirs| earlier(files, mine, theirs) }
+            called.merge(payload[1])
+          when :stats then Stats.merge(payload[0])
+          when :error then raise payload[0]
+          end
+        end
+      end
+      results.flatten + unused_method_records(files, defined, called)
+    ensure
+      (workers || []).each do |pipe, pid|
+        pipe.close
+        Process.kill(:TERM, pid) rescue nil
+        Process.wait(pid) rescue nil
+      end
+    end
+
+   private
+
+    # Forks a worker for the files at the given indices.
+    #
+    # @return [(IO, Integer)] the reading end of its pipe and its pid
+    def spawn(files, shard, scanner)
+      reader, writer = IO.pipe
+      pid = fork do
+        reader.close
+        begin
+          Stats.reset if Stats.enabled?
+          shard.each do |index|
+            warnings = scanner.scan_file(File.read(files[index]), files[index])
+            Marshal.dump([:file, index, warnings.map { |warning| Record.from(warning) }], writer)
+          end
+          Marshal.dump([:methods, *method_records(scanner)], writer)
+          Marshal.dump([:stats, Stats.snapshot], writer) if Stats.enabled?
+        rescue StandardError => err
+          Marshal.dump([:error, "#{err.class}: #{err.message}"], writer) rescue nil
+          exit!(1)
+        end
+        writer.close
+        exit!(0)
+      end
+      writer.close
+      [reader, pid]
+    end
+
+    # The unused method warning of each user method this worker loaded, by
+    # owner#name, and the names of those that calls resolved to.
+    def method_records(scanner)
+      defined, called = {}, []
+      Analysis::MethodAnalysis.each_user_method do |method|
+        next if method.builtin || method.special
+        key = "#{method.owner.path}##{method.name}"
+        defined[key] = Record.from(scanner.uncalled_method_warning(method))
+        called << key if method.dispatched?
+      end
+      [defined, called]
+    end
+
+    # The methods no worker called, in the order of the files they are in.
+    def unused_method_records(files, defined, called)
+      unused = defined.reject { |key, _| called.include?(key) }.values
+      unused.sort_by { |record| position(files, record) }
+    end
+
+    # Of two workers' records of one method, the one a single process would
+    # have kept: the first, in the order of the files.
+    def earlier(files, record, other)
+      (position(files, other) <=> position(files, record)) < 0 ? other : record
+    end
+
+    def position(files, record)
+      [files.index(record.file) || files.size, record.line_number.to_i]
+    end
+  end
+end
@@ -0,0 +1,139 @@
+require_relative 'spec_helper'
+
+describe ControlFlow::BasicBlock do
+  before do
+    @block = ControlFlow::BasicBlock.new('A')
+    @normal, @raised, @dead = %w(B C D).map { |name| ControlFlow::BasicBlock.new(name) }
+    @block.join(@normal)
+    @block.set_flag(@normal, RGL::ControlFlowGraph::EDGE_NORMAL | RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+    @block.join(@raised)
+    @block.set_flag(@raised, RGL::ControlFlowGraph::EDGE_ABNORMAL)
+    @block.join(@dead)
+    @block.set_flag(@dead, RGL::ControlFlowGraph::EDGE_FAKE)
+  end
+
+  describe 'filtered edges' do
+    it 'caches a frozen array per filter until the edges change' do
+      real = @block.real_successors
+      real.map(&:name).should == %w(B C)
+      real.should be_frozen
+      @block.real_successors.should equal(real)
+      @block.add_flag(@raised, RGL::ControlFlowGraph::EDGE_FAKE)
+      @block.real_successors.map(&:name).should == %w(B)
+    end
+
+    it 'enumerates, tests and counts without building arrays' do
+      names = []
+      @block.each_abnormal_successors { |succ| names << succ.name }
+      names.should == %w(C)
+      @block.any_executed_successor?.should be_true
+      @raised.any_executed_predecessor?.should be_false
+      @block.normal_successor_count.should == 2
+      @normal.executed_predecessor_count.should == 1
+    end
+  end
+
+  describe 'phi nodes' do
+    before do
+      @join = ControlFlow::BasicBlock.new('Join')
+      @normal.join(@join)
+      @raised.join(@join)
+      @call = ControlFlow::Instruction.new([:call, :t3, :t1, :foo], block: @join)
+      @join.instructions = [[:phi, :t1, :a, :b], [:phi, :t2, :c, :d]].map do |body|
+        ControlFlow::Instruction.new(body, block: @join)
+      end << @call
+      [@normal, @raised].each do |pred|
+        pred.instructions = [ControlFlow::Instruction.new([:jump, 'Join'], block: pred)]
+      end
+    end
+
+    it 'tracks the phi nodes at the head of the instructions' do
+      @join.phi_count.should == 2
+      @join.phi_nodes.map { |node| node[1] }.should == [:t1, :t2]
+      @join.natural_instructions.should == [@call]
+      @join.unshift_phi(ControlFlow::Instruction.new([:phi, :t0, :e, :f], block: @join))
+      @join.phi_count.should == 3
+      @join.phi_nodes.map { |node| node[1] }.should == [:t0, :t1, :t2]
+    end
+
+    it 'enumerates phi nodes and the rest without building arrays' do
+      phis, naturals = [], []
+      @join.each_phi { |node| phis << node[1] }
+      @join.each_natural_instruction { |insn| naturals << insn }
+      phis.should == [:t1, :t2]
+      naturals.should == [@call]
+    end
+
+    it 'collapses phi nodes out of the prefix when an edge is removed' do
+      @raised.disconnect(@join)
+      @join.phi_count.should == 0
+      @join.natural_instructions.map(&:type).should == [:assign, :assign, :call]
+      @join.instructions.first.body.should == [:assign, :t1, :a]
+    end
+
+    it 'keeps phi args with their real predecessors when a fake edge moves' do
+      dest = ControlFlow::BasicBlock.new('Dest')
+      a, b, c, fake = %w(A B C F).map { |name| ControlFlow::BasicBlock.new(name) }
+      [a, b, c, fake].each do |pred|
+        pred.join(dest)
+        pred.instructions = [ControlFlow::Instruction.new([:jump, 'Dest'], block: pred)]
+      end
+      fake.add_flag(dest, RGL::ControlFlowGraph::EDGE_FAKE)
+      dest.instructions = [ControlFlow::Instruction.new([:phi, :t1, :a, :b, :c], block: dest)]
+      a.disconnect(dest)
+      dest.real_predecessors.to_a.should == [b, c]
+      dest.instructions.first.body.should == [:phi, :t1, :b, :c]
+      b.disconnect(dest)
+      dest.instructions.first.body.should == [:assign, :t1, :c]
+    end
+  end
+
+  describe 'native counters' do
+    before do
+      ControlFlow.reset_native_counters
+    end
+
+    it 'counts edges, lookups and cached views' do
+      @block.join(@normal.dup)
+      @block.get_flags(@dead)
+      @block.real_successors
+      @block.real_successors
+      @block.each_real_successors { }
+      counters = ControlFlow.native_counters
+      counters[:edges_created].should == 1
+      counters[:edge_scans].should >= 1
+      counters[:edge_scan_steps].should >= 3
+      counters[:view_misses].should == 1
+      counters[:view_hits].should == 1
+      counters[:arrays_allocated].should == 1
+    end
+
+    it 'resets to zero' do
+      @block.disconnect_without_fixup(@dead)
+      ControlFlow.native_counters[:edges_destroyed].should == 1
+      ControlFlow.reset_native_counters
+      ControlFlow.native_counters.values.uniq.should == [0]
+    end
+  end
+
+  describe 'garbage collection' do
+    it 'reports the memory held by its edges' do
+      require 'objspace'
+      wide = ControlFlow::BasicBlock.new('Wide')
+      base = ObjectSpace.memsize_of(wide)
+      base.should > 0
+      20.times { |i| wide.join(ControlFlow::BasicBlock.new("W#{i}")) }
+      ObjectSpace.memsize_of(wide).should > base
+    end
+
+    it 'keeps its edges and caches across compaction' do
+      if GC.respond_to?(:verify_compaction_references)
+        real = @block.real_successors
+        GC.verify_compaction_references(expand_heap: true, toward: :empty)
+        @block.real_successors.should equal(real)
+        @block.successors.map(&:name).should == %w(B C D)
+        @normal.predecessors.map(&:name).should == %w(A)
+      end
+    end
+  end
+end
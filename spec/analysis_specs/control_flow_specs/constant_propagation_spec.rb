@@ -558,3 +558,44 @@ EOF
     g.should have_constant('z').with_value(['aa', 'bb', 'cc'])
   end
 end
+
+describe ControlFlow::ConstantPropagation::Driver do
+  # Enter -> A -> B -> Exit, with a fake edge A -> C
+  before do
+    @graph = ControlFlow::ControlFlowGraph.new
+    @a, @b, @c = %w(A B C).map { |name| ControlFlow::BasicBlock.new(name) }
+    [@a, @b, @c].each { |block| @graph.add_vertex(block) }
+    @graph.add_edge(@graph.enter, @a)
+    @graph.add_edge(@a, @b)
+    @graph.add_edge(@a, @c, RGL::ControlFlowGraph::EDGE_FAKE)
+    @graph.add_edge(@b, @graph.exit)
+    @assign = ControlFlow::Instruction.new([:assign, nil, 1], block: @a)
+    @a.instructions = [@assign, ControlFlow::Instruction.new([:jump, 'B'], block: @a)]
+    @stranded = ControlFlow::Instruction.new([:assign, nil, 2], block: @c)
+    @c.instructions = [@stranded]
+  end
+
+  it 'follows jumps and fall-throughs natively, yielding the rest' do
+    driver = ControlFlow::ConstantPropagation::Driver.new
+    driver.push_block(@graph.enter)
+    evaluated = []
+    driver.run { |instruction| evaluated << instruction }
+    evaluated.size.should == 1
+    evaluated.first.equal?(@assign).should be_true
+    @graph.is_executable?(@a, @b).should be_true
+    @graph.is_executable?(@b, @graph.exit).should be_true
+    @graph.is_executable?(@a, @c).should be_false
+  end
+
+  it 'skips instructions in blocks not known to execute' do
+    driver = ControlFlow::ConstantPropagation::Driver.new
+    driver.push_instruction(@stranded)
+    driver.push_instruction(@stranded)
+    evaluated = []
+    driver.run { |instruction| evaluated << instruction }
+    evaluated.should be_empty
+    driver.consider_edge(@graph.enter, @a).should be_true
+    driver.consider_edge(@graph.enter, @a).should be_false
+    driver.consider_edge(@a, @c).should be_false
+  end
+end
@@ -1,5 +1,174 @@
 require_relative 'spec_helper'
 
-describe ControlFlow::ControlFlowGraph do  
-  
+describe ControlFlow::ControlFlowGraph do
+  describe '#add_vertex' do
+    it 'assigns dense ids and looks blocks up by name' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b = %w(A B).map { |name| ControlFlow::BasicBlock.new(name) }
+      graph.add_vertex(a)
+      graph.add_vertex(b)
+      graph.num_vertices.should == 4
+      [graph.enter, graph.exit, a, b].map(&:id).should == [0, 1, 2, 3]
+      graph.vertex_with_name('B').should == b
+      graph.vertex(a.id).should == a
+      graph[a].should == a
+      graph.has_vertex?(a).should be_true
+    end
+  end
+
+  describe '#remove_vertex' do
+    it 'removes edges and recycles the id' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b = %w(A B).map { |name| ControlFlow::BasicBlock.new(name) }
+      graph.add_vertex(a)
+      graph.add_edge(graph.enter, a)
+      graph.add_edge(a, graph.exit)
+      id = a.id
+      graph.remove_vertex(a)
+      graph.num_vertices.should == 2
+      graph.num_edges.should == 0
+      graph.has_vertex?(a).should be_false
+      graph.vertex_with_name('A').should be_nil
+      graph.add_vertex(b)
+      b.id.should == id
+    end
+  end
+
+  describe '#add_edge' do
+    it 'records edges with their flags' do
+      graph = ControlFlow::ControlFlowGraph.new
+      graph.add_edge(graph.enter, graph.exit, RGL::ControlFlowGraph::EDGE_FAKE)
+      graph.num_edges.should == 1
+      graph.has_edge?(graph.enter, graph.exit).should be_true
+      graph.is_fake?(graph.enter, graph.exit).should be_true
+      graph.out_degree(graph.enter).should == 1
+      graph.in_degree(graph.exit).should == 1
+    end
+  end
+
+  describe '#add_edges' do
+    it 'adds flat from, to, flags triples in one batch' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a = ControlFlow::BasicBlock.new('A')
+      graph.add_vertex(a)
+      graph.enter.successors.should be_empty
+      graph.add_edges([graph.enter, a, nil, a, graph.exit, RGL::ControlFlowGraph::EDGE_ABNORMAL])
+      graph.enter.successors.map(&:name).should == %w(A)
+      graph.is_abnormal?(a, graph.exit).should be_true
+      graph.reverse_post_order.map(&:name).should == %w(Enter A Exit)
+    end
+
+    it 'adds nothing if any block is outside the graph' do
+      graph = ControlFlow::ControlFlowGraph.new
+      stray = ControlFlow::BasicBlock.new('A')
+      lambda { graph.add_edges([graph.enter, graph.exit, nil, graph.enter, stray, nil]) }.should raise_error(ArgumentError)
+      graph.num_edges.should == 0
+    end
+
+    it 'rejects flags that do not fit in an edge' do
+      graph = ControlFlow::ControlFlowGraph.new
+      [256, -1].each do |flags|
+        lambda { graph.add_edges([graph.enter, graph.exit, flags]) }.should raise_error(ArgumentError)
+      end
+      graph.num_edges.should == 0
+    end
+  end
+
+  describe '#remove_edge' do
+    it 'moves the last predecessor into the removed slot' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b, c, d = %w(A B C D).map { |name| ControlFlow::BasicBlock.new(name) }
+      [a, b, c, d].each { |block| graph.add_vertex(block) }
+      [a, b, c].each { |block| graph.add_edge(block, d) }
+      a.disconnect_without_fixup(d)
+      d.predecessors.map(&:name).should == %w(C B)
+    end
+
+    it 'keeps flags straight on blocks with many successors' do
+      graph = ControlFlow::ControlFlowGraph.new
+      blocks = (0...40).map { |i| ControlFlow::BasicBlock.new("B#{i}") }
+      blocks.each { |block| graph.add_vertex(block) }
+      blocks.each_with_index { |block, i| graph.add_edge(graph.enter, block, 1 << (i % 5)) }
+      graph.enter.disconnect_without_fixup(blocks[7])
+      graph.has_edge?(graph.enter, blocks[7]).should be_false
+      blocks.each_with_index do |block, i|
+        graph.enter.get_flags(block).should == 1 << (i % 5) unless i == 7
+      end
+    end
+  end
+
+  describe '#copy_topology' do
+    it 'copies blocks and flagged edges under the same ids' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b = %w(A B).map { |name| ControlFlow::BasicBlock.new(name) }
+      [a, b].each { |block| graph.add_vertex(block) }
+      graph.add_edge(graph.enter, a)
+      graph.add_edge(a, b, RGL::ControlFlowGraph::EDGE_ABNORMAL)
+      graph.add_edge(graph.enter, b)
+      graph.add_edge(b, graph.exit)
+      copy = ControlFlow::ControlFlowGraph.new
+      lookup = copy.copy_topology(graph)
+      lookup[graph.enter.id].should equal(copy.enter)
+      new_a, new_b = lookup[a.id], lookup[b.id]
+      new_a.name.should == 'A'
+      new_a.id.should == a.id
+      new_a.should_not equal(a)
+      copy.vertex_with_name('B').should equal(new_b)
+      new_b.predecessors.map(&:name).should == %w(A Enter)
+      new_a.get_flags(new_b).should == RGL::ControlFlowGraph::EDGE_ABNORMAL
+      copy.num_edges.should == 4
+      copy.remove_vertex(new_b)
+      graph.num_edges.should == 4
+    end
+  end
+
+  describe '#reverse_post_order' do
+    it 'numbers the blocks reachable over real edges and caches the order' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b, c = %w(A B C).map { |name| ControlFlow::BasicBlock.new(name) }
+      [a, b, c].each { |block| graph.add_vertex(block) }
+      graph.add_edge(graph.enter, a)
+      graph.add_edge(a, b)
+      graph.add_edge(b, graph.exit)
+      graph.add_edge(a, c, RGL::ControlFlowGraph::EDGE_FAKE)
+      order = graph.reverse_post_order
+      order.map(&:name).should == %w(Enter A B Exit)
+      graph.reverse_post_order.should equal(order)
+      b.post_order_number.should == 1
+      b.reverse_post_order_number.should == 2
+      b.preorder_number.should == 2
+      b.dfs_parent.should equal(a)
+      c.post_order_number.should be_nil
+      graph.reachable?(c).should be_false
+    end
+
+    it 'is recomputed when an edge changes' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a = ControlFlow::BasicBlock.new('A')
+      graph.add_vertex(a)
+      graph.add_edge(graph.enter, graph.exit)
+      graph.reverse_post_order.map(&:name).should == %w(Enter Exit)
+      graph.add_edge(graph.enter, a)
+      graph.reachable?(a).should be_true
+      graph.enter.add_flag(a, RGL::ControlFlowGraph::EDGE_FAKE)
+      graph.reachable?(a).should be_false
+    end
+  end
+
+  describe '#kill_unexecuted_edges' do
+    it 'marks unexecuted real edges fake, cutting off what they reached' do
+      graph = ControlFlow::ControlFlowGraph.new
+      a, b, c = %w(A B C).map { |name| ControlFlow::BasicBlock.new(name) }
+      [a, b, c].each { |block| graph.add_vertex(block) }
+      graph.add_edge(graph.enter, a, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+      graph.add_edge(a, b)
+      graph.add_edge(a, graph.exit, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+      graph.add_edge(b, graph.exit, RGL::ControlFlowGraph::EDGE_FAKE)
+      graph.unreachable_vertices.map(&:name).should == %w(C)
+      graph.kill_unexecuted_edges.should == 1
+      graph.is_fake?(a, b).should be_true
+      graph.is_fake?(graph.enter, a).should be_false
+      graph.unreachable_vertices.map(&:name).sort.should == %w(B C)
+    end
+  end
 end
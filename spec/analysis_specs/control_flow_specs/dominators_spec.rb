@@ -0,0 +1,182 @@
+require_relative 'spec_helper'
+
+describe RGL::Graph do
+  # Enter -> A -> B -> D -> Exit
+  #           \-> C -/
+  def diamond_graph
+    graph = ControlFlow::ControlFlowGraph.new
+    a, b, c, d = %w(A B C D).map { |name| ControlFlow::BasicBlock.new(name) }
+    [a, b, c, d].each { |block| graph.add_vertex(block) }
+    graph.add_edge(graph.enter, a)
+    graph.add_edge(a, b)
+    graph.add_edge(a, c)
+    graph.add_edge(b, d)
+    graph.add_edge(c, d)
+    graph.add_edge(d, graph.exit)
+    graph
+  end
+
+  describe '#dominator_tree' do
+    it 'stores the immediate dominator on each block' do
+      graph = diamond_graph
+      graph.dominator_tree.should == graph.enter
+      graph.enter.idom.should be_nil
+      graph.vertex_with_name('A').idom.should == graph.enter
+      graph.vertex_with_name('B').idom.should == graph.vertex_with_name('A')
+      graph.vertex_with_name('C').idom.should == graph.vertex_with_name('A')
+      graph.vertex_with_name('D').idom.should == graph.vertex_with_name('A')
+      graph.exit.idom.should == graph.vertex_with_name('D')
+    end
+
+    it 'links the dominated children of each block' do
+      graph = diamond_graph
+      graph.dominator_tree
+      graph.vertex_with_name('A').dominated_children.map(&:name).sort.should == %w(B C D)
+      graph.vertex_with_name('B').dominated_children.should be_empty
+    end
+
+    it 'answers dominance queries' do
+      graph = diamond_graph
+      graph.dominator_tree
+      graph.vertex_with_name('A').dominates?(graph.exit).should be_true
+      graph.vertex_with_name('A').dominates?(graph.vertex_with_name('A')).should be_true
+      graph.vertex_with_name('B').dominates?(graph.vertex_with_name('D')).should be_false
+      graph.vertex_with_name('D').dominates?(graph.vertex_with_name('A')).should be_false
+    end
+
+    it 'ignores fake edges' do
+      graph = diamond_graph
+      graph.add_edge(graph.vertex_with_name('B'), graph.exit, RGL::ControlFlowGraph::EDGE_FAKE)
+      graph.dominator_tree
+      graph.exit.idom.should == graph.vertex_with_name('D')
+    end
+  end
+
+  describe '#dominance_frontier' do
+    it 'finds the join points of the diamond' do
+      graph = diamond_graph
+      graph.dominator_tree
+      frontier = graph.dominance_frontier
+      frontier[graph.vertex_with_name('B')].map(&:name).should == %w(D)
+      frontier[graph.vertex_with_name('C')].map(&:name).should == %w(D)
+      frontier[graph.vertex_with_name('A')].should be_empty
+    end
+  end
+
+  describe '#iterated_dominance_frontiers' do
+    it 'computes DF+ for many sets at once, including the sets themselves' do
+      graph = diamond_graph
+      graph.dominator_tree
+      b, c = graph.vertex_with_name('B'), graph.vertex_with_name('C')
+      first, second = graph.iterated_dominance_frontiers([[b], [graph.enter, c]])
+      first.map(&:name).sort.should == %w(B D)
+      second.map(&:name).sort.should == %w(C D Enter)
+    end
+  end
+
+  describe '#postdominator_tree' do
+    it 'finds the immediate postdominator of each block' do
+      graph = diamond_graph
+      tree = graph.postdominator_tree
+      tree.exit.should == graph.exit
+      tree.ipdom(graph.exit).should be_nil
+      tree.ipdom(graph.vertex_with_name('A')).should == graph.vertex_with_name('D')
+      tree.ipdom(graph.vertex_with_name('B')).should == graph.vertex_with_name('D')
+      tree.ipdom(graph.enter).should == graph.vertex_with_name('A')
+      tree.postdominates?(graph.vertex_with_name('D'), graph.enter).should be_true
+      tree.postdominates?(graph.vertex_with_name('B'), graph.vertex_with_name('A')).should be_false
+    end
+
+    it 'finds the branches each block is control dependent on' do
+      graph = diamond_graph
+      tree = graph.postdominator_tree
+      tree.control_dependences(graph.vertex_with_name('B')).map(&:name).should == %w(A)
+      tree.control_dependences(graph.vertex_with_name('C')).map(&:name).should == %w(A)
+      tree.control_dependences(graph.vertex_with_name('D')).should be_empty
+    end
+
+    it 'follows edits to the graph' do
+      graph = diamond_graph
+      tree = graph.postdominator_tree
+      b = graph.vertex_with_name('B')
+      b.add_flag(graph.vertex_with_name('D'), RGL::ControlFlowGraph::EDGE_FAKE)
+      graph.postdominator_tree.should equal(tree)
+      tree.ipdom(b).should be_nil
+      tree.ipdom(graph.vertex_with_name('A')).should == graph.vertex_with_name('C')
+      tree.control_dependences(graph.vertex_with_name('C')).should be_empty
+    end
+  end
+
+  describe 'ControlFlow.precompute_all' do
+    it 'computes the dominators and frontiers of many graphs at once' do
+      graphs = [diamond_graph, diamond_graph]
+      ControlFlow.precompute_all(graphs, 2).should == graphs
+      graphs.each do |graph|
+        graph.exit.idom.should == graph.vertex_with_name('D')
+        graph.vertex_with_name('B').dominance_frontier.map(&:name).should == %w(D)
+      end
+    end
+
+    it 'follows edges added after precomputation' do
+      graph = diamond_graph
+      ControlFlow.precompute_all([graph])
+      graph.add_edge(graph.vertex_with_name('B'), graph.exit)
+      graph.dominator_tree
+      graph.exit.idom.should == graph.vertex_with_name('A')
+    end
+
+    describe 'after an edit' do
+      it 'places a block inserted on an edge' do
+        graph = diamond_graph
+        graph.dominator_tree
+        b, d = graph.vertex_with_name('B'), graph.vertex_with_name('D')
+        inserted = ControlFlow::BasicBlock.new('X')
+        graph.add_vertex(inserted)
+        b.insert_block_on_edge(d, inserted)
+        inserted.idom.should == b
+        d.idom.should == graph.vertex_with_name('A')
+        b.dominates?(inserted).should be true
+        inserted.dominance_frontier.should == [d]
+        exit_block = ControlFlow::BasicBlock.new('Y')
+        graph.add_vertex(exit_block)
+        d.insert_block_on_edge(graph.exit, exit_block)
+        graph.exit.idom.should == exit_block
+        d.dominates?(graph.exit).should be true
+      end
+
+      it 'pushes idoms down when an edge is removed' do
+        graph = diamond_graph
+        graph.dominator_tree
+        b, c, d = %w(B C D).map { |name| graph.vertex_with_name(name) }
+        c.disconnect_without_fixup(d)
+        d.idom.should == b
+        b.dominates?(graph.exit).should be true
+        b.dominance_frontier.should be_empty
+      end
+
+      it 'drops blocks cut off by a fake edge' do
+        graph = diamond_graph
+        graph.dominator_tree
+        a, b, c, d = %w(A B C D).map { |name| graph.vertex_with_name(name) }
+        a.add_flag(c, RGL::ControlFlowGraph::EDGE_FAKE)
+        c.idom.should be_nil
+        a.dominates?(c).should be false
+        d.idom.should == b
+        a.remove_flag(c, RGL::ControlFlowGraph::EDGE_FAKE)
+        graph.dominator_tree
+        c.idom.should == a
+        d.idom.should == a
+      end
+
+      it 'pulls idoms up when an edge is added' do
+        graph = diamond_graph
+        graph.dominator_tree
+        a, b, d = %w(A B D).map { |name| graph.vertex_with_name(name) }
+        graph.add_edge(a, graph.exit)
+        graph.exit.idom.should == a
+        d.dominates?(graph.exit).should be false
+        d.dominance_frontier.should == [graph.exit]
+      end
+    end
+  end
+end
@@ -0,0 +1,41 @@
+require_relative 'spec_helper'
+
+describe ControlFlow::Liveness do
+  # A -> B -> C
+  #      ^---/
+  before do
+    @a, @b, @c = %w(A B C).map { |name| ControlFlow::BasicBlock.new(name) }
+    [[@a, @b], [@b, @c], [@c, @b]].each do |from, to|
+      from.join(to)
+      from.set_flag(to, RGL::ControlFlowGraph::EDGE_NORMAL)
+    end
+    @x, @y = Object.new, Object.new
+    # A defines x, C uses x and defines y, B uses y.
+    @liveness = ControlFlow::Liveness.new(
+        [@a, @b, @c], [[], [@y], [@x]], [[@x], [], [@y]])
+  end
+
+  it 'finds the blocks a temp is live on entry to' do
+    @liveness.live_in?(@x, @b).should be_true
+    @liveness.live_in?(@x, @c).should be_true
+    @liveness.live_in?(@x, @a).should be_false
+  end
+
+  it 'prunes live blocks not reachable from a definition' do
+    # y is upward-exposed in B, and B is reachable from C which defines it.
+    @liveness.live?(@y, @b).should be_true
+    # y is live into A's successor but A itself is not reached by a definition.
+    @liveness.live_in?(@y, @a).should be_true
+    @liveness.live?(@y, @a).should be_false
+  end
+
+  it 'computes live-out sets' do
+    @liveness.live_out(@a).should == [@x]
+    @liveness.live_out(@c).should include(@x, @y)
+  end
+
+  it 'records definition blocks of used temps' do
+    @liveness.definition_blocks(@x).should == [@a]
+    @liveness.temps.should include(@x, @y)
+  end
+end
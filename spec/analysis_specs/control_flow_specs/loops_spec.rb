@@ -0,0 +1,84 @@
+require_relative 'spec_helper'
+
+describe 'loop nesting forest' do
+  # Enter -> A -> H -> B -> H
+  #               \-> C -> A
+  #                    \-> D -> Exit
+  before do
+    @graph = ControlFlow::ControlFlowGraph.new
+    @a, @h, @b, @c, @d = %w(A H B C D).map { |name| ControlFlow::BasicBlock.new(name) }
+    [@a, @h, @b, @c, @d].each { |block| @graph.add_vertex(block) }
+    @graph.add_edge(@graph.enter, @a)
+    @graph.add_edge(@a, @h)
+    @graph.add_edge(@h, @b)
+    @graph.add_edge(@h, @c)
+    @graph.add_edge(@b, @h)
+    @graph.add_edge(@c, @a)
+    @graph.add_edge(@c, @d)
+    @graph.add_edge(@d, @graph.exit)
+  end
+
+  it 'finds the back edges and headers of the natural loops' do
+    @graph.back_edges.map { |from, to| [from.name, to.name] }.sort.should == [%w(B H), %w(C A)]
+    @graph.loop_headers.map(&:name).should == %w(H A)
+    @b.is_back_edge?(@h).should be_true
+    @h.is_back_edge?(@b).should be_false
+  end
+
+  it 'nests the loops' do
+    @h.loop_header?.should be_true
+    @b.loop_header.should == @h
+    @c.loop_header.should == @a
+    @d.loop_header.should be_nil
+    @h.outer_loop_header.should == @a
+    @a.outer_loop_header.should be_nil
+    [@graph.enter, @a, @h, @b, @c, @d].map(&:loop_depth).should == [0, 1, 2, 2, 1, 0]
+  end
+
+  it 'keeps each loop together in the worklist order' do
+    @graph.reverse_post_order.map(&:name).should == %w(Enter A H C D Exit B)
+    @graph.loop_order.map(&:name).should == %w(Enter A H B C D Exit)
+  end
+
+  it 'follows edits to the graph' do
+    @c.add_flag(@a, RGL::ControlFlowGraph::EDGE_FAKE)
+    @graph.loop_headers.map(&:name).should == %w(H)
+    @h.loop_depth.should == 1
+    @c.loop_header.should be_nil
+  end
+
+  it 'keeps its traversal when an edge is only marked executable' do
+    order = @graph.reverse_post_order
+    @c.add_flag(@a, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+    @graph.reverse_post_order.should equal(order)
+    @c.executed_successors.should == [@a]
+    @c.loop_header.should == @a
+  end
+
+  it 'lets a terminating loop simulate for more than half the budget' do
+    simulation = ControlFlow::Simulation
+    steps = Hash.new(0).compare_by_identity
+    opts = {remaining_blocks: 10, loop_budget: simulation::LoopBudget.new(simulation::MAX_SIMULATION_LOOP_BLOCKS)}
+    @graph.simulate_take_step(@a, @graph.enter, steps, opts)
+    @graph.simulate_take_step(@h, @a, steps, opts)
+    30_000.times do
+      @graph.simulate_take_step(@b, @h, steps, opts)
+      @graph.simulate_take_step(@h, @b, steps, opts)
+    end
+    @graph.simulate_take_step(@c, @h, steps, opts)
+    @graph.simulate_take_step(@d, @c, steps, opts)
+    steps[@a].should == 60_003
+    opts[:remaining_blocks].should == 9
+    lambda do
+      @graph.simulate_take_step(@a, @c, steps, opts)
+      loop { @graph.simulate_take_step(@h, @a, steps, opts) }
+    end.should raise_error(simulation::NonDeterminismHappened)
+  end
+
+  it 'does not count an irreducible cycle as a loop' do
+    @graph.add_edge(@a, @b)
+    @graph.loop_headers.map(&:name).should == %w(A)
+    @h.loop_header.should == @a
+    @b.is_back_edge?(@h).should be_false
+  end
+end
@@ -0,0 +1,78 @@
+require_relative 'spec_helper'
+
+describe ControlFlow::Overlay do
+  # Enter -> A -> B -> Exit
+  #           \-------/
+  before do
+    @graph = ControlFlow::ControlFlowGraph.new
+    @a, @b = %w(A B).map { |name| ControlFlow::BasicBlock.new(name) }
+    [@a, @b].each { |block| @graph.add_vertex(block) }
+    @graph.add_edge(@graph.enter, @a)
+    @graph.add_edge(@a, @b)
+    @graph.add_edge(@a, @graph.exit)
+    @graph.add_edge(@b, @graph.exit)
+    @overlay = ControlFlow::Overlay.new(@graph)
+  end
+
+  it 'keeps its edge flags apart from the graph' do
+    @overlay.enter
+    @graph.entered_overlay.should equal(@overlay)
+    @a.add_flag(@graph.exit, RGL::ControlFlowGraph::EDGE_FAKE)
+    @a.real_successors.map(&:name).should == %w(B)
+    @overlay.leave
+    @graph.entered_overlay.should be_nil
+    @a.real_successors.map(&:name).should == %w(B Exit)
+    @overlay.size.should == 1
+    @overlay.enter
+    @a.is_fake?(@graph.exit).should be_true
+    @overlay.leave
+  end
+
+  it 'keeps the dominator tree in step with its flags' do
+    @graph.dominator_tree
+    @graph.exit.idom.should == @a
+    @overlay.enter
+    @a.add_flag(@graph.exit, RGL::ControlFlowGraph::EDGE_FAKE)
+    @graph.exit.idom.should == @b
+    @overlay.leave
+    @graph.exit.idom.should == @a
+  end
+
+  it 'takes turns with other overlays of the graph' do
+    other = ControlFlow::Overlay.new(@graph)
+    @overlay.enter
+    @a.add_flag(@b, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+    lambda { other.enter }.should raise_error(RuntimeError)
+    @overlay.leave
+    other.enter
+    @a.is_executable?(@b).should be_false
+    @b.add_flag(@graph.exit, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+    other.leave
+    @overlay.enter
+    @a.is_executable?(@b).should be_true
+    @b.is_executable?(@graph.exit).should be_false
+    @overlay.leave
+  end
+
+  it 'goes stale when an edge is removed from the graph' do
+    @overlay.enter
+    @a.add_flag(@b, RGL::ControlFlowGraph::EDGE_EXECUTABLE)
+    @overlay.leave
+    @a.disconnect_without_fixup(@graph.exit)
+    @overlay.should be_stale
+    lambda { @overlay.enter }.should raise_error(RuntimeError)
+  end
+
+  it 'puts back the values computed in the graph after a run' do
+    @graph.bind_block_type(Types::NILCLASS)
+    @overlay.run do |graph|
+      graph.bind_block_type(Types::PROC)
+      graph.constants[:x] = 1
+    end
+    @graph.block_type.should == Types::NILCLASS
+    @graph.constants.should be_empty
+    @overlay.run do |graph|
+      graph.block_type.should == Types::PROC
+    end
+  end
+end
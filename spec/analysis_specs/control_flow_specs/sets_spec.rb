@@ -0,0 +1,63 @@
+require_relative 'spec_helper'
+
+describe ControlFlow::BlockSet do
+  before do
+    @graph = ControlFlow::ControlFlowGraph.new
+    @a, @b, @c = %w(A B C).map { |name| ControlFlow::BasicBlock.new(name) }
+    [@a, @b, @c].each { |block| @graph.add_vertex(block) }
+  end
+
+  it 'holds blocks of its graph' do
+    set = ControlFlow::BlockSet.new(@graph, [@a])
+    set.add?(@b).should equal(set)
+    set.add?(@b).should be_nil
+    set.include?(@b).should be_true
+    set.include?(@c).should be_false
+    set.size.should == 2
+    set.map(&:name).should == %w(A B)
+    lambda { set << ControlFlow::BasicBlock.new('D') }.should raise_error(ArgumentError)
+  end
+
+  it 'combines sets of the same graph' do
+    left = ControlFlow::BlockSet.new(@graph, [@a, @b])
+    right = ControlFlow::BlockSet.new(@graph, [@b, @c])
+    (left | right).map(&:name).should == %w(A B C)
+    (left & right).map(&:name).should == %w(B)
+    (left - right).map(&:name).should == %w(A)
+    (left - [@a]).map(&:name).should == %w(B)
+    left.should == ControlFlow::BlockSet.new(@graph, [@b, @a])
+  end
+
+  it 'pops its members' do
+    set = ControlFlow::BlockSet.new(@graph, [@c, @a])
+    set.pop.should == @a
+    set.pop.should == @c
+    set.pop.should be_nil
+    set.should be_empty
+  end
+end
+
+describe ControlFlow::TempSet do
+  before do
+    @temps = %w(a b c).map { |name| Bindings::TemporaryBinding.new(name, nil) }
+  end
+
+  it 'holds temps by identity' do
+    set = ControlFlow::TempSet.new(@temps.first(2))
+    set.include?(@temps[1]).should be_true
+    set.include?(Bindings::TemporaryBinding.new('b', nil)).should be_false
+    set.delete?(@temps[0]).should equal(set)
+    set.delete?(@temps[0]).should be_nil
+    set.to_a.should == [@temps[1]]
+  end
+
+  it 'combines sets of one universe or of several' do
+    left = ControlFlow::TempSet.new(@temps.first(2))
+    shared = ControlFlow::TempSet.new(@temps.last(2), left)
+    apart = ControlFlow::TempSet.new(@temps.last(2))
+    (left | shared).size.should == 3
+    (left & apart).to_a.should == [@temps[1]]
+    (left - shared).should == ControlFlow::TempSet.new([@temps[0]])
+    left.merge(apart).size.should == 3
+  end
+end
@@ -0,0 +1,43 @@
+require_relative 'spec_helper'
+require 'tmpdir'
+
+describe ParseCache do
+  before do
+    @old_directory = SETTINGS[:cache_dir]
+    @directory = Dir.mktmpdir
+    SETTINGS[:cache_dir] = @directory
+  end
+
+  after do
+    SETTINGS[:cache_dir] = @old_directory
+    FileUtils.rm_rf(@directory)
+  end
+
+  it 'parses as RipperPlus does' do
+    ParseCache.sexp('a = 1').should == RipperPlus.sexp('a = 1')
+  end
+
+  it 'reads unchanged text back without parsing it' do
+    tree = ParseCache.sexp('p 1 + 2')
+    RipperPlus.should_not_receive(:sexp)
+    ParseCache.sexp('p 1 + 2').should == tree
+  end
+
+  it 'keys entries by the text and the Laser and parser versions' do
+    ParseCache.entry_path('x').should_not == ParseCache.entry_path('y')
+    ParseCache.entry_path('x').should include(Laser::Version::STRING)
+    ParseCache.entry_path('x').should include(ParseCache.parser_version)
+  end
+
+  it 'treats a corrupt entry as a miss' do
+    tree = ParseCache.sexp('foo(bar)')
+    File.open(ParseCache.entry_path('foo(bar)'), 'wb') { |file| file.write("\x04\x08[") }
+    ParseCache.sexp('foo(bar)').should == tree
+  end
+
+  it 'parses without caching when no directory is set' do
+    SETTINGS[:cache_dir] = nil
+    ParseCache.sexp('a = 1').should == RipperPlus.sexp('a = 1')
+    Dir[File.join(@directory, '**', '*')].select { |path| File.file?(path) }.should be_empty
+  end
+end
@@ -13,6 +13,7 @@ describe Runner do
                            InlineCommentSpaceWarning::OPTION_KEY => 2,
                            :"line-length" => nil, only: nil, stdin: false,
                            display: true, :"list-modules" => false, profile: false,
+                           stats: nil, :"cache-dir" => nil, server: false, socket: nil, jobs: nil,
                            S: false, include: [],
                            __using__: Warning.all_warnings,
                            __fix__: Warning.all_warnings}
@@ -24,14 +25,14 @@ describe Runner do
       file1, file2 = mock(:file1), mock(:file2)
 
       scanner.should_receive(:settings).exactly(3).times.and_return({:"report-fixed" => true})
-      File.should_receive(:read).with('hello').twice.and_return(data1)
+      File.should_receive(:read).with('hello').and_return(data1)
       scanner.should_receive(:scan).
               with(data1, 'hello').
               and_return([warning1])
       warning1.should_receive(:to_ary)
 
       scanner.should_receive(:settings).and_return({})
-      File.should_receive(:read).with('world').twice.and_return(data2)
+      File.should_receive(:read).with('world').and_return(data2)
       scanner.should_receive(:scan).
               with(data2, 'world').
               and_return([warning2])
@@ -49,6 +50,7 @@ describe Runner do
                            :"line-length" => nil, only: 'UselessDoubleQuotesWarning',
                            stdin: true, stdin_given: true, only_given: true,
                            display: true, :"list-modules" => false, profile: false,
+                           stats: nil, :"cache-dir" => nil, server: false, socket: nil, jobs: nil,
                            S: false, include: [],
                            __using__: [UselessDoubleQuotesWarning],
                            __fix__: [UselessDoubleQuotesWarning]}
@@ -59,7 +61,7 @@ describe Runner do
       warning1 = mock(:warning1)
 
       scanner.should_receive(:settings).twice.and_return({:"report-fixed" => true})
-      STDIN.should_receive(:read).twice.and_return(data1)
+      STDIN.should_receive(:read).and_return(data1)
       scanner.should_receive(:scan).
               with(data1, '(stdin)').
               and_return([warning1])
@@ -141,6 +143,12 @@ describe Runner do
       settings[:"report-fixed"].should be_true
       settings[:"report-fixed_given"].should be_true
     end
+
+    it 'has a --stats option' do
+      runner = Runner.new(['--stats', 'stats.json'])
+      settings = runner.swizzling_argv { runner.get_settings }
+      settings[:stats].should == 'stats.json'
+    end
   end
 
   describe '#handle_global_options' do
@@ -0,0 +1,54 @@
+require_relative 'spec_helper'
+require 'tmpdir'
+require 'stringio'
+
+describe Server do
+  def request(server, request)
+    server_end, client_end = UNIXSocket.pair
+    server.serve(server_end)
+    client_end.puts(JSON.generate(request))
+    JSON.parse(client_end.read)
+  ensure
+    client_end.close
+  end
+
+  it 'runs laser in a forked child and returns what it printed' do
+    response = request(Server.new, argv: ['--list-modules'], cwd: Dir.pwd)
+    response['status'].should == 0
+    response['stdout'].split("\n").should include('Array < Object')
+  end
+
+  it 'returns the exit status of runs that exit' do
+    response = request(Server.new, argv: ['--not-an-option'], cwd: Dir.pwd)
+    response['status'].should_not == 0
+    response['stderr'].should include('not-an-option')
+  end
+
+  it 'leaves its own process untouched' do
+    request(Server.new, argv: ['--line-length', '101'], cwd: Dir.tmpdir)
+    Dir.pwd.should_not == Dir.tmpdir
+    Warning.all_warnings.none? do |warning|
+      warning.superclass == GenericLineLengthWarning && warning.line_length_limit == 101
+    end.should be_true
+  end
+end
+
+describe Client do
+  before do
+    @path = File.join(Dir.tmpdir, "laser-spec-#{Process.pid}.sock")
+    @server = fork { Server.new(@path).run }
+    sleep 0.01 until File.socket?(@path)
+  end
+
+  after do
+    Process.kill(:TERM, @server)
+    Process.wait(@server)
+  end
+
+  it 'runs laser on the server and returns its exit status' do
+    output = swizzling_io do
+      Client.new(@path).run(['--stdin'], StringIO.new("a = 1\n")).should == 0
+    end
+    output.should include('warnings found')
+  end
+end
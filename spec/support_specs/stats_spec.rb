@@ -0,0 +1,49 @@
+require_relative 'spec_helper'
+
+describe Stats do
+  after do
+    Stats.disable!
+    Stats.reset
+  end
+
+  it 'only yields while disabled' do
+    Stats.time(:parse, 'a.rb') { 3 }.should == 3
+    Stats.to_h[:stages].should be_empty
+  end
+
+  it 'aggregates stage times by stage, file, and method' do
+    Stats.enable!
+    Stats.time(:parse, 'a.rb') { }
+    Stats.time(:ssa, 'a.rb', 'A#foo') { }
+    Stats.time(:ssa, 'b.rb', 'B#bar') { }
+    stats = Stats.to_h
+    stats[:stages][:ssa][:calls].should == 2
+    stats[:stages][:parse][:calls].should == 1
+    stats[:files].keys.should =~ ['a.rb', 'b.rb']
+    stats[:files]['a.rb'][:stages].keys.should =~ [:parse, :ssa]
+    stats[:methods].keys.should =~ ['A#foo', 'B#bar']
+    stats[:methods]['A#foo'][:total].should >= 0.0
+  end
+
+  it 'charges nested stages only to the inner stage' do
+    Stats.enable!
+    Stats.time(:simulation, 'a.rb') do
+      Stats.time(:constant_propagation, 'a.rb') { sleep 0.02 }
+    end
+    stages = Stats.to_h[:stages]
+    stages[:constant_propagation][:time].should >= 0.02
+    stages[:simulation][:time].should < 0.02
+  end
+
+  it 'returns the value of the block and records stages that raise' do
+    Stats.enable!
+    Stats.time(:build) { :graph }.should == :graph
+    expect { Stats.time(:build) { raise ArgumentError } }.to raise_error(ArgumentError)
+    Stats.to_h[:stages][:build][:calls].should == 2
+  end
+
+  it 'reports the native CFG counters' do
+    Stats.enable!
+    Stats.to_h[:native].keys.should include(:edges_created, :edge_scan_steps, :view_hits)
+  end
+end
@@ -0,0 +1,35 @@
+require_relative 'spec_helper'
+require 'tmpdir'
+require 'fileutils'
+
+describe WorkerPool do
+  before do
+    @dir = Dir.mktmpdir
+    @files = (1..3).map do |number|
+      path = File.join(@dir, "file#{number}.rb")
+      File.open(path, 'w') { |file| file.write("a = 1\n" * number + "b = 2 \n") }
+      path
+    end
+  end
+
+  after do
+    FileUtils.rm_rf(@dir)
+  end
+
+  it 'scans the files in workers and returns their warnings in file order' do
+    scanner = Scanner.new(__using__: [ExtraWhitespaceWarning], __fix__: [])
+    records = WorkerPool.new(2).scan(@files, scanner)
+    records.map { |record| [record.file, record.line_number] }.should ==
+        [[@files[0], 2], [@files[1], 3], [@files[2], 4]]
+    records.first.name.should == 'Extra Whitespace'
+    records.first.should be_fixable
+  end
+
+  it 'reports a method as unused only if no worker called it' do
+    foo = WorkerPool::Record.new('a.rb', 1, 'Unused method', 5, 'The method A#foo is never called.', false)
+    bar = WorkerPool::Record.new('a.rb', 4, 'Unused method', 5, 'The method A#bar is never called.', false)
+    baz = WorkerPool::Record.new('b.rb', 2, 'Unused method', 5, 'The method B#baz is never called.', false)
+    defined = {'B#baz' => baz, 'A#bar' => bar, 'A#foo' => foo}
+    WorkerPool.new(2).send(:unused_method_records, ['a.rb', 'b.rb'], defined, Set['A#bar']).should == [foo, baz]
+  end
+end